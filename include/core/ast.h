@@ -1,6 +1,10 @@
 #ifndef CORE_AST_H
 #define CORE_AST_H
 
+#include <llvm/ADT/APFloat.h>
+#include <llvm/ADT/APInt.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/IR/Attributes.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Type.h>
@@ -35,13 +39,30 @@ enum TreeCode {
   ArrayAccessExpression,
   DeRefExpression,
   RefExpression,
-  StringLiteral
+  StringLiteral,
+
+  // ranges of the abstract classes, used by classof
+  FirstStatement = FunctionArgLists,
+  LastStatement = WhileStatement,
+  FirstExpression = ConstantExpr,
+  LastExpression = StringLiteral,
+  FirstLocatorExpression = IdentifierExpr,
+  LastLocatorExpression = RefExpression
 };
 };
 
-struct TypeInfo;
+class Type;
 class BuiltinType;
 
+/// A local variable, either an argument or a declaration. Sema binds every
+/// use of the variable to it
+struct TypeInfo {
+  Type *type;
+  Symbol name;
+  /// where the variable lives, set by codegen
+  llvm::Value *address = nullptr;
+};
+
 class FunctionDecl;
 class Expression;
 class Statement;
@@ -50,8 +71,10 @@ class ASTBase {
 public:
   virtual void dump();
 
-  ASTBase(const std::vector<Expression *> childrens, FilePos pos);
-  ASTBase(const std::vector<Statement *> childrens, FilePos pos);
+  ASTBase(code::TreeCode code, const std::vector<Expression *> childrens,
+          SourceLocation pos);
+  ASTBase(code::TreeCode code, const std::vector<Statement *> childrens,
+          SourceLocation pos);
 
   // nullptr on failure
   const FunctionDecl *getFirstFunctionDecl() const;
@@ -61,12 +84,15 @@ public:
   const ASTBase *getScopeDeclLoc() const;
 
   const ASTBase *getParent() const;
-  const std::set<ASTBase *> &getChildren() const;
-  const FilePos &getPos() const;
+  /// in the order they were added, which is the source order
+  llvm::ArrayRef<ASTBase *> getChildren() const;
+  SourceLocation getLocation() const;
 
   void debugDump(int depth = 1);
 
-  virtual code::TreeCode getCode() const = 0;
+  /// set once by the constructor of the concrete class, isa and dyncast
+  /// compare it instead of going through the C++ RTTI
+  code::TreeCode getCode() const;
 
   static bool doesDefineScope(const ASTBase *at);
   static bool doesDefineScope(code::TreeCode code);
@@ -77,27 +103,38 @@ protected:
   void removeChildren(ASTBase *children);
 
 private:
-  FilePos m_locus;
+  code::TreeCode m_code;
+  SourceLocation m_locus;
   ASTBase *m_parent;
-  std::string m_name;
-  std::set<ASTBase *> m_childrens;
+  // most nodes have a handful of children, they are kept inline
+  llvm::SmallVector<ASTBase *, 4> m_childrens;
 };
 
 //============================== Statements ==============================
 class Statement : public ASTBase {
 public:
-  Statement(const std::vector<ASTBase *> childrens, FilePos locus);
+  Statement(code::TreeCode code, const std::vector<ASTBase *> childrens,
+            SourceLocation locus);
   virtual void codegen(ContextHolder holder) = 0;
 
+  static bool classof(const ASTBase *node) {
+    return node->getCode() >= code::FirstStatement &&
+           node->getCode() <= code::LastStatement;
+  }
+
 private:
 };
 
 class CallStatement : public Statement {
 public:
-  CallStatement(Expression *call_expression, FilePos locus);
+  CallStatement(Expression *call_expression, SourceLocation locus);
 
   virtual void codegen(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::CallStatement;
+  }
+
+  Expression *getCallExpression();
 
 private:
   Expression *m_call_expr;
@@ -107,14 +144,17 @@ class FunctionArgLists : public Statement {
 public:
   using ArgsIter = std::vector<TypeInfo>::const_iterator;
 
-  FunctionArgLists(std::vector<TypeInfo> &&args, FilePos locus);
+  FunctionArgLists(std::vector<TypeInfo> &&args, SourceLocation locus);
 
   // the first few alloc, and load instruction
   virtual void codegen(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::FunctionArgLists;
+  }
 
   ArgsIter begin() const;
   ArgsIter end() const;
+  std::vector<TypeInfo> &getArgs();
 
 private:
   std::vector<TypeInfo> m_args;
@@ -126,17 +166,26 @@ public:
   /// if `is_extern` is true, codegen only generate a declaration and assume to
   /// have no body
   FunctionDecl(std::vector<Statement *> &expression, FunctionArgLists *arg_list,
-               std::string &&name, Type *return_type, bool is_extern,
-               FilePos locus);
+               Symbol name, Type *return_type, bool is_extern,
+               SourceLocation locus);
 
   virtual void codegen(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::FunctionDecl;
+  }
 
   void dump() override;
 
-  const std::string &getName() const;
+  Symbol getName() const;
+  bool isExtern() const;
+  /// true if the body had syntax errors, its statements are only the ones
+  /// that could be recovered. Sema knows the function but skips the body
+  bool isInvalid() const;
+  void setInvalid();
   llvm::Function *getLLVMFunction() const;
   Type *getReturnType() const;
+  const std::vector<Statement *> &getStatements() const;
+  FunctionArgLists *getArgList();
   llvm::FunctionType *getFunctionType(ContextHolder holder) const;
 
   const FunctionArgLists::ArgsIter getArgBegin() const;
@@ -147,11 +196,12 @@ private:
   void emitAllocs(ContextHolder holder);
 
   bool m_is_extern; // is external or not?
+  bool m_is_invalid = false;
 
   Type *m_return_type;
   std::vector<Statement *> m_statements;
   FunctionArgLists *m_arg_list;
-  std::string m_name;
+  Symbol m_name;
 
   // nullptr before codegen
   llvm::Function *m_function = nullptr;
@@ -160,13 +210,18 @@ private:
 class AssignmentStatement : public Statement {
 public:
   AssignmentStatement(Expression *ref_expression, Expression *expression,
-                      FilePos locus);
+                      SourceLocation locus);
 
   virtual void codegen(ContextHolder holder) override;
   virtual void dump() override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::AssignmentStatement;
+  }
   const std::string &getName();
 
+  Expression *getRefExpression();
+  Expression *getExpression();
+
 private:
   Expression *m_ref_expr; // The right hand side of the equation
   Expression *m_expression;
@@ -175,10 +230,15 @@ private:
 class ReturnStatement : public Statement {
 public:
   // returning an identifier
-  ReturnStatement(Expression *expression, FilePos locus);
+  ReturnStatement(Expression *expression, SourceLocation locus);
 
   virtual void codegen(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::ReturnStatement;
+  }
+
+  /// nullptr for a bare ret
+  Expression *getExpression();
 
 private:
   // this gives some sort of value
@@ -189,31 +249,38 @@ class DeclarationStatement : public Statement {
 public:
   // if expression is nullptr, it means that we just allocate space
   // and don't assign it to the thing
-  DeclarationStatement(const std::string &name, Expression *expression,
-                       Type *type, FilePos locus);
+  DeclarationStatement(Symbol name, Expression *expression, Type *type,
+                       SourceLocation locus);
 
   virtual void dump() override;
   virtual void codegen(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::DeclarationStatement;
+  }
   Expression* getExpression();
   Type* getType();
-  const std::string& getName();
+  Symbol getName();
+  TypeInfo *getVariable();
 private:
 
-  std::string m_name;
   Expression *m_expression;
-  Type *m_type;
+  TypeInfo m_variable;
 };
 
 class IfStatement : public Statement {
 public:
   IfStatement(Expression *cond, std::vector<Statement *> &&expressions,
-              FilePos locus);
+              SourceLocation locus);
   virtual void dump() override;
   virtual void codegen(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::IfStatement;
+  }
 
   std::vector<DeclarationStatement*> getDeclarationStatements() const;
+  Expression *getCondition();
+  const std::vector<Statement *> &getStatements() const;
+
 private:
   // m_cond is a expression which may or may not be i1.
   // this is a terrible name
@@ -224,12 +291,16 @@ private:
 class WhileStatement : public Statement {
 public:
   WhileStatement(Expression *cond, std::vector<Statement *> &&expressions,
-                 FilePos locus);
+                 SourceLocation locus);
   virtual void codegen(ContextHolder holder) override;
   virtual void dump() override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::WhileStatement;
+  }
 
   std::vector<DeclarationStatement*> getDeclarationStatements() const;
+  Expression *getCondition();
+  const std::vector<Statement *> &getStatements() const;
 
 private:
   Expression *m_cond;
@@ -238,18 +309,65 @@ private:
 
 //============================== Expressions ==============================
 // These are expressions that yields some sort of value
+/// The value of a constant expression, folded by Sema. An integer has the
+/// bit width of its vcc type (a bool is one bit wide), a float is single
+/// precision
+class ConstantValue {
+public:
+  explicit ConstantValue(llvm::APInt integer);
+  explicit ConstantValue(llvm::APFloat floating);
+
+  bool isFloat() const;
+  const llvm::APInt &getInteger() const;
+  const llvm::APFloat &getFloat() const;
+
+  llvm::Constant *emit(ContextHolder holder) const;
+
+private:
+  bool m_is_float;
+  llvm::APInt m_integer;
+  llvm::APFloat m_float;
+};
+
 class Expression : public ASTBase {
 public:
-  Expression(const std::vector<Expression *> childrens, FilePos locus);
-  virtual Type *getType(ContextHolder holder) = 0;
+  Expression(code::TreeCode code, const std::vector<Expression *> childrens,
+             SourceLocation locus);
   virtual llvm::Value *getVal(ContextHolder holder) = 0;
+
+  /// the type of the value, computed once by Sema before code generation.
+  /// nullptr before that, or if the expression is ill formed
+  Type *getType() const;
+  void setType(Type *type);
+
+  /// the value of the expression if Sema could fold it, nullptr otherwise and
+  /// for a literal. Code generation emits the constant instead of the
+  /// expression
+  const ConstantValue *getConstant() const;
+  void setConstant(const ConstantValue *constant);
+
+  static bool classof(const ASTBase *node) {
+    return node->getCode() >= code::FirstExpression &&
+           node->getCode() <= code::LastExpression;
+  }
+
+private:
+  Type *m_type = nullptr;
+  const ConstantValue *m_constant = nullptr;
 };
 
 /// Basically like an L value in c++,
 /// This is something that returns an value
 class LocatorExpression : public Expression {
 public:
-  LocatorExpression(const std::vector<Expression *> &childrens, FilePos locus);
+  LocatorExpression(code::TreeCode code,
+                    const std::vector<Expression *> &childrens,
+                    SourceLocation locus);
+
+  static bool classof(const ASTBase *node) {
+    return node->getCode() >= code::FirstLocatorExpression &&
+           node->getCode() <= code::LastLocatorExpression;
+  }
 
   /// recursively traverse the tree to get the reference to
   /// the current type
@@ -262,11 +380,12 @@ protected:
 
 class ConstantExpr : public Expression {
 public:
-  explicit ConstantExpr(int value, FilePos locus);
+  explicit ConstantExpr(int value, SourceLocation locus);
   virtual void dump() override;
   virtual llvm::Value *getVal(ContextHolder holder) override;
-  virtual Type *getType(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::ConstantExpr;
+  }
 
   int getValue();
 
@@ -276,16 +395,25 @@ private:
 
 class CallExpr : public Expression {
 public:
-  CallExpr(const std::string &name,
-           const std::vector<Expression *> &expressions, FilePos locus);
+  CallExpr(Symbol name, const std::vector<Expression *> &expressions,
+           SourceLocation locus);
   llvm::Value *getVal(ContextHolder holder) override;
   void dump() override;
 
-  virtual Type *getType(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::CallExpr;
+  }
+
+  Symbol getName() const;
+  const std::vector<Expression *> &getArguments() const;
+
+  /// the function called, set by Sema
+  FunctionDecl *getFunctionDecl() const;
+  void setFunctionDecl(FunctionDecl *function_decl);
 
 private:
-  std::string m_func_name;
+  FunctionDecl *m_function_decl = nullptr;
+  Symbol m_func_name;
   std::vector<Expression *> m_expressions;
 };
 
@@ -304,16 +432,28 @@ public:
     Divide,
   };
   static BinaryExpressionType getFromLexType(lex::Token lex_type);
-  virtual Type *getType(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::BinaryExpression;
+  }
 
 public:
-  BinaryExpression(Expression *lhs, BinaryExpressionType type, FilePos locus);
+  BinaryExpression(Expression *lhs, BinaryExpressionType type,
+                   SourceLocation locus);
 
   virtual void dump() override;
   virtual llvm::Value *getVal(ContextHolder holder) override;
 
   void setRHS(Expression *rhs);
+  Expression *getLHS();
+  Expression *getRHS();
+  BinaryExpressionType getKind() const;
+  /// true for the comparisons, which give a bool
+  bool isComparison() const;
+
+  /// the operand the expression is equal to, such as x in x * 1, nullptr if
+  /// there is none. Code generation emits that operand alone
+  Expression *getSimplified() const;
+  void setSimplified(Expression *operand);
 
 private:
   llvm::Value *handleInteger(ContextHolder holder, llvm::Value *lhs,
@@ -322,6 +462,7 @@ private:
   Expression *m_lhs;
   Expression *m_rhs;
   BinaryExpressionType m_kind;
+  Expression *m_simplified = nullptr;
 };
 
 // For the following expression
@@ -330,17 +471,23 @@ private:
 // cast<int>(a);
 class CastExpression : public Expression {
 public:
-  CastExpression(Expression *cast_expression, Type *casted_to, FilePos loc);
+  CastExpression(Expression *cast_expression, Type *casted_to,
+                 SourceLocation loc);
 
   virtual llvm::Value *getVal(ContextHolder holder) override;
-  virtual Type *getType(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::CastExpression;
+  }
+
+  Expression *getExpression();
+  Type *getCastTo();
+  /// whether a value of type from can be cast to to
+  static bool canCast(Type *from, Type *to);
 
 private:
   llvm::Value *builtinCast(BuiltinType *from, BuiltinType *to,
                            ContextHolder holder);
 
-  void emitErrorAndExit(ContextHolder holder);
   Expression *m_to_be_casted_expression;
   Type *m_cast_to;
 };
@@ -353,79 +500,114 @@ public:
   /// name - the name of the identifier/variable
   /// compute_ref - true if codegen returns an address, otherwise returns the
   /// value to the identifier
-  IdentifierExpr(const std::string &name, FilePos locus);
+  IdentifierExpr(Symbol name, SourceLocation locus);
 
   virtual void dump() override;
   virtual llvm::Value *getVal(ContextHolder holder) override;
-  virtual Type *getType(ContextHolder holder) override;
   virtual llvm::Value *getRef(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::IdentifierExpr;
+  }
+
+  Symbol getName() const;
+  /// the variable named, set by Sema
+  TypeInfo *getVariable() const;
+  void setVariable(TypeInfo *variable);
 
 private:
-  std::string m_name;
+  Symbol m_name;
+  TypeInfo *m_variable = nullptr;
 };
 
 // FIXME: maybe we should do type deduction here instead!
 // The parser parse enough type so that this won't be a problem
 class MemberAccessExpression : public LocatorExpression {
 public:
-  MemberAccessExpression(const std::string &name, const std::string &member,
-                         FilePos locus);
+  MemberAccessExpression(Symbol name, Symbol member, SourceLocation locus);
 
   // from nested postfix-expression
-  MemberAccessExpression(LocatorExpression *parent, const std::string &member,
-                         FilePos locus);
+  MemberAccessExpression(LocatorExpression *parent, Symbol member,
+                         SourceLocation locus);
 
   virtual void dump() override;
   virtual llvm::Value *getVal(ContextHolder holder) override;
   virtual llvm::Value *getRef(ContextHolder holder) override;
-  virtual Type *getType(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::MemberAccessExpression;
+  }
 
   llvm::Value *getCurrentRef(ContextHolder holder);
 
-  Type *getGEPType(ContextHolder holder);
-  Type *getGEPChildType(ContextHolder holder);
+  /// the struct being accessed, set by Sema
+  Type *getGEPType() const;
+  void setGEPType(Type *type);
+  /// the type of the member
+  Type *getGEPChildType() const;
 
   void setChildPosfixExpression(LocatorExpression *child);
+  LocatorExpression *getParentExpression();
+  LocatorExpression *getChildPosfixExpression();
+  /// only meaningful without a parent expression
+  Symbol getBaseName() const;
+  Symbol getMember() const;
+  /// the variable of m_base_name, set by Sema
+  TypeInfo *getVariable() const;
+  void setVariable(TypeInfo *variable);
 
 private:
+  Type *m_gep_type = nullptr;
+  TypeInfo *m_variable = nullptr;
   // either we have a m_base_name for symbol lookup or we must have a parent
   // expression
   LocatorExpression *m_parent = nullptr, *m_child_posfix_expression = nullptr;
-  std::string m_base_name; // only used when m_parent == nullptr
-  std::string m_member;    // the member we are accessing
+  Symbol m_base_name; // only used when m_parent == nullptr
+  Symbol m_member;    // the member we are accessing
 };
 
 // FIXME: maybe we should do type deduction here instead!
 class ArrayAccessExpression : public LocatorExpression {
 public:
-  ArrayAccessExpression(const std::string &name, Expression *expression,
-                        FilePos locus);
+  ArrayAccessExpression(Symbol name, Expression *expression,
+                        SourceLocation locus);
   ArrayAccessExpression(LocatorExpression *parent, Expression *expression,
-                        FilePos locus);
+                        SourceLocation locus);
 
   virtual void dump() override;
   virtual llvm::Value *getVal(ContextHolder holder) override;
   virtual llvm::Value *getRef(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::ArrayAccessExpression;
+  }
 
   llvm::Value *getCurrentRef(ContextHolder holder);
 
-  Type *getGEPType(ContextHolder holder);
-  Type *getGEPChildType(ContextHolder holder);
-  virtual Type *getType(ContextHolder holder) override;
+  /// the array indexed into, or the pointee of the pointer, set by Sema
+  Type *getGEPType() const;
+  void setGEPType(Type *type);
+  /// the type of the element
+  Type *getGEPChildType() const;
 
   void setChildPosfixExpression(LocatorExpression *child);
+  LocatorExpression *getParentExpression();
+  LocatorExpression *getChildPosfixExpression();
+  Expression *getIndexExpression();
+  /// only meaningful without a parent expression
+  Symbol getBaseName() const;
+  /// the variable of m_base_name, set by Sema
+  TypeInfo *getVariable() const;
+  void setVariable(TypeInfo *variable);
 
 private:
+  Type *m_gep_type = nullptr;
+  TypeInfo *m_variable = nullptr;
   ///=== CODEGEN Options ====
   Expression *m_index_expression; // the index number
   // either we have a m_base_name for symbol lookup or we must have a parent
   // expression
-  std::string m_base_name; //
+  Symbol m_base_name; //
   LocatorExpression *m_parent_expression = nullptr,
-                    *m_child_posfix_expression; // the member we are accessing
+                    *m_child_posfix_expression =
+                        nullptr; // the member we are accessing
 };
 
 // This is a weird expression
@@ -435,18 +617,22 @@ private:
 // deref<a> = 10 #  `` return the address of the pointee
 class DeRefExpression : public LocatorExpression {
 public:
-  DeRefExpression(Expression *ref_get, FilePos locus);
+  DeRefExpression(Expression *ref_get, SourceLocation locus);
 
   virtual void dump() override;
   virtual llvm::Value *getVal(ContextHolder holder) override;
   virtual llvm::Value *getRef(ContextHolder holder) override;
-  virtual Type *getType(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::DeRefExpression;
+  }
 
   llvm::Value *getCurrentRef(ContextHolder holder);
-  Type *getInnerType(ContextHolder holder);
+  /// the pointee of the dereferenced pointer
+  Type *getInnerType() const;
 
   void setPosfixChildExpression(LocatorExpression *expression);
+  Expression *getPointerExpression();
+  LocatorExpression *getPosfixChildExpression();
 
 private:
   Expression *m_ref;
@@ -461,13 +647,16 @@ private:
 // ptr int a = ref<c>; # this makes well form
 class RefExpression : public LocatorExpression {
 public:
-  RefExpression(Expression *inner, FilePos locus);
+  RefExpression(Expression *inner, SourceLocation locus);
 
   virtual void dump() override;
   virtual llvm::Value *getVal(ContextHolder holder) override;
   virtual llvm::Value *getRef(ContextHolder holder) override;
-  virtual Type *getType(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::RefExpression;
+  }
+
+  Expression *getInnerExpression();
 
 private:
   Expression *m_inner_expression;
@@ -478,12 +667,13 @@ private:
 // ptr char some_string = "this is my first string";
 class StringLiteral : public Expression {
 public:
-  StringLiteral(std::string string, FilePos locus);
+  StringLiteral(std::string string, SourceLocation locus);
 
   virtual void dump() override;
   virtual llvm::Value *getVal(ContextHolder holder) override;
-  virtual Type *getType(ContextHolder holder) override;
-  virtual code::TreeCode getCode() const override;
+  static bool classof(const ASTBase *node) {
+    return node->getCode() == code::StringLiteral;
+  }
 
 private:
   std::string m_string_literal;
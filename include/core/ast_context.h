@@ -0,0 +1,80 @@
+#ifndef CORE_AST_CONTEXT_H
+#define CORE_AST_CONTEXT_H
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace vcc {
+/// Owns every AST node and Type of a compilation. Objects are bump allocated
+/// out of large slabs and are never freed one at a time, everything goes
+/// away at once when the context is destroyed
+class ASTContext {
+public:
+  static constexpr std::size_t SlabSize = 64 * 1024;
+
+  ASTContext() = default;
+  ~ASTContext();
+
+  ASTContext(const ASTContext &other) = delete;
+  ASTContext &operator=(const ASTContext &other) = delete;
+
+  /// constructs a T in the arena
+  template <typename T, typename... Args> T *create(Args &&...args) {
+    T *object = new (allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>)
+      m_destructors.push_back(
+          {object, [](void *object) { static_cast<T *>(object)->~T(); }});
+    return object;
+  }
+
+  void *allocate(std::size_t size, std::size_t alignment);
+
+  /// Takes over every object of other, which is left empty. An arena is not
+  /// thread safe, so each thread allocates from its own and they are merged
+  /// once the threads are done
+  void adopt(ASTContext &other);
+
+  /// the bytes handed out, and the bytes taken from the system for them
+  std::size_t getBytesAllocated() const;
+  std::size_t getBytesReserved() const;
+
+  /// Ends a phase of the compilation, such as parsing or code generation,
+  /// and records how many bytes were allocated during it
+  void endPhase(std::string name);
+
+  /// one line per phase, and the totals
+  void printStats(std::ostream &os) const;
+
+private:
+  char *allocateSlab(std::size_t size);
+
+  std::vector<std::unique_ptr<char[]>> m_slabs;
+  // [m_current, m_end) is what is left of the current slab
+  char *m_current = nullptr;
+  char *m_end = nullptr;
+  std::size_t m_allocated = 0;
+  std::size_t m_reserved = 0;
+
+  // the objects are destroyed in the reverse order of their creation
+  struct Destructor {
+    void *object;
+    void (*destroy)(void *object);
+  };
+  std::vector<Destructor> m_destructors;
+
+  struct Phase {
+    std::string name;
+    std::size_t bytes;
+  };
+  std::vector<Phase> m_phases;
+  std::size_t m_phase_start = 0;
+};
+} // namespace vcc
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CORE_CHUNKED_TABLE_H
+#define CORE_CHUNKED_TABLE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace vcc {
+/// An append only array indexed by 32 bit ids. The elements live in chunks
+/// that double in size and are never moved or reallocated, so a reference to
+/// an element stays valid until clear(), and get() takes no lock.
+///
+/// push() and clear() must be serialized by the caller. get(index) may run in
+/// any thread that received index from push() through some synchronization,
+/// such as the lock that push() ran under
+template <typename T, unsigned FirstChunkBits = 10> class ChunkedTable {
+public:
+  ChunkedTable() = default;
+  ~ChunkedTable() { clear(); }
+
+  ChunkedTable(const ChunkedTable &other) = delete;
+  ChunkedTable &operator=(const ChunkedTable &other) = delete;
+
+  /// appends value and returns its index
+  std::uint32_t push(T value) {
+    std::size_t index = m_size.load(std::memory_order_relaxed);
+    assert(index < UINT32_MAX && "the table is full");
+    auto [chunk, offset] = locate(index);
+    T *elements = m_chunks[chunk].load(std::memory_order_relaxed);
+    if (!elements) {
+      elements = new T[std::size_t(1) << (chunk + FirstChunkBits)];
+      m_chunks[chunk].store(elements, std::memory_order_release);
+    }
+    elements[offset] = std::move(value);
+    m_size.store(index + 1, std::memory_order_release);
+    return index;
+  }
+
+  const T &get(std::uint32_t index) const {
+    auto [chunk, offset] = locate(index);
+    const T *elements = m_chunks[chunk].load(std::memory_order_acquire);
+    assert(elements && "index was never pushed");
+    return elements[offset];
+  }
+
+  std::size_t size() const { return m_size.load(std::memory_order_acquire); }
+
+  /// frees every element, which invalidates every index and reference
+  void clear() {
+    for (std::atomic<T *> &chunk : m_chunks)
+      delete[] chunk.exchange(nullptr, std::memory_order_relaxed);
+    m_size.store(0, std::memory_order_release);
+  }
+
+private:
+  // chunk k holds the indices [2^(k+b) - 2^b, 2^(k+1+b) - 2^b), where b is
+  // FirstChunkBits, so that index + 2^b has its top bit at k + b
+  static constexpr unsigned ChunkCount = 33 - FirstChunkBits;
+
+  static std::pair<unsigned, std::size_t> locate(std::uint32_t index) {
+    std::uint64_t biased = std::uint64_t(index) + (1u << FirstChunkBits);
+    unsigned top = 63 - __builtin_clzll(biased);
+    return {top - FirstChunkBits, biased - (std::uint64_t(1) << top)};
+  }
+
+  std::atomic<T *> m_chunks[ChunkCount] = {};
+  std::atomic<std::size_t> m_size = 0;
+};
+}; // namespace vcc
+#endif
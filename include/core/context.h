@@ -6,11 +6,16 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "core/ast_context.h"
+#include "core/source.h"
 #include "core/stream.h"
-#include "core/symbol_table.h"
 
 namespace vcc {
+class ASTBase;
+class TypeContext;
 namespace lex {
 class Tokenizer;
 struct Token;
@@ -18,6 +23,11 @@ struct Token;
 
 class DiagnosticDriver {
 public:
+  /// locations of nodes are resolved through sources. A buffered driver
+  /// keeps its messages instead of printing them, until they are taken by
+  /// takeDiagnostics
+  explicit DiagnosticDriver(SourceManager &sources, bool buffered = false);
+
   void diag(const std::string &message);
   /// FIXME: this is terrible style, maybe we should just pass the line to be
   /// printed, or just a format. This is because there could be
@@ -25,37 +35,73 @@ public:
   ///
   /// Diagnose with a message at the current token of the tokenizer
   void diag(lex::Tokenizer &tokenizer, const std::string &message);
-  void diag(const ASTBase *node, const std::string &line_in_file,
-            const std::string &message);
+  void diag(const ASTBase *node, const std::string &message);
 
   /// True if there was as error being diagnose, a.k.a diag is Called
   bool hasError() const;
+  unsigned getErrorCount() const;
+
+  /// once limit errors were reported the rest are only counted, after one
+  /// message that says so. 0 means no limit. The parser and Sema stop early
+  /// when it is reached
+  void setErrorLimit(unsigned limit);
+  unsigned getErrorLimit() const;
+  bool reachedErrorLimit() const;
+
+  /// reports the messages kept by the buffered driver other, as if they were
+  /// diagnosed here. This is how errors found on other threads are reported
+  /// in source order
+  void takeDiagnostics(DiagnosticDriver &other);
+  /// the messages kept so far, always empty when not buffered
+  const std::vector<std::string> &getMessages() const;
 
 private:
-  void printFilePos(const FilePos &pos, const std::string &message);
-  void printSeeHere(const FilePos &pos);
+  void printFilePos(std::ostream &os, const std::string &name,
+                    const FilePos &pos, const std::string &message);
+  void printSeeHere(std::ostream &os, const FilePos &pos);
+  /// prints a whole message, or keeps it when buffered
+  void emit(std::string message);
+
+  /// counts the error, false if it should not be printed anymore
+  bool countError();
+  SourceManager &m_sources;
+  /// how many times diag was called
+  unsigned m_error_count = 0;
+  unsigned m_error_limit = 0;
 
-  void setError();
-  /// True if diag was called!
-  bool m_error = false;
+  bool m_buffered;
+  std::vector<std::string> m_messages;
 };
 
 // FIXME: this really should be a class
 struct GlobalContext {
-  GlobalContext(const char *path_to_file);
+  /// the main file is the first source, the one that is parsed. With
+  /// buffer_diagnostics the errors are kept in diagnostics, not printed
+  GlobalContext(const char *path_to_file,
+                FileStream::Backend backend = FileStream::Buffered,
+                bool buffer_diagnostics = false);
+
+  /// compile source that is already in memory, name is used in messages
+  GlobalContext(std::string_view buffer, std::string name,
+                bool buffer_diagnostics = false);
+  ~GlobalContext();
 
   llvm::LLVMContext context;
   llvm::IRBuilder<> builder;
   llvm::Module module;
 
-  // symbol table
-  SymbolTable symbol_table;
+  // every source, and the one being compiled
+  SourceManager sources;
+  SourceManager::FileID main_file;
+
   DiagnosticDriver diagnostics;
-  FileStream stream;
 
-  inline std::string getLine(const FilePos &pos) {
-    return stream.getLine(pos.loc);
-  }
+  // owns the syntax tree
+  ASTContext ast;
+  // owns the types, there is one of each
+  std::unique_ptr<TypeContext> types;
+
+  inline FileStream &getMainStream() { return sources.getStream(main_file); }
 };
 
 using ContextHolder = std::shared_ptr<GlobalContext>;
@@ -1,9 +1,88 @@
 #ifndef CORE_DRIVER_H
 #define CORE_DRIVER_H
 
+#include "core/lex.h"
+#include "core/stream.h"
+#include "core/symbol.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace vcc {
 class Parser;
-Parser parseFile(const char *path_to_file);
+class Statement;
+struct GlobalContext;
+
+/// How a source is compiled, everything the command line of vcc can change
+struct CompilerOptions {
+  FileStream::Backend backend = FileStream::Buffered;
+  lex::Tokenizer::Mode mode = lex::Tokenizer::Streaming;
+  /// compilation stops after this many errors, 0 means that every error is
+  /// reported
+  unsigned error_limit = 20;
+  /// the number of threads the function bodies are parsed on, see Parser
+  unsigned thread_count = 1;
+  /// the functions whose bodies are compiled, with the ones they call. Empty
+  /// means every function, see Parser
+  std::vector<Symbol> entry_points;
+  /// keep the diagnostics in the context instead of printing them, see
+  /// CompilerInstance::getDiagnostics
+  bool buffer_diagnostics = false;
+  /// the data layout of the target, as a string. Empty for the default one
+  /// of LLVM
+  std::string data_layout;
+};
+
+/// One compilation, from a source to the IR in its own llvm::Module. An
+/// instance owns all of its state, so any number of them can run at once on
+/// different threads
+class CompilerInstance {
+public:
+  explicit CompilerInstance(CompilerOptions options = CompilerOptions());
+  ~CompilerInstance();
+
+  CompilerInstance(const CompilerInstance &other) = delete;
+  CompilerInstance &operator=(const CompilerInstance &other) = delete;
+
+  /// Parses the source and generates its IR. Returns false if an error was
+  /// diagnosed, then there is no IR when the source could not be parsed. An
+  /// instance compiles a single source
+  bool compileFile(const char *path_to_file);
+  bool compileBuffer(std::string_view buffer, std::string name = "<buffer>");
+
+  bool haveError() const;
+  /// the messages of the errors, only kept with buffer_diagnostics
+  const std::vector<std::string> &getDiagnostics() const;
+
+  /// only valid after a compile
+  std::shared_ptr<GlobalContext> getContext() const;
+  const std::vector<Statement *> &getSyntaxTree() const;
+
+private:
+  bool compile(std::shared_ptr<GlobalContext> context);
+
+  CompilerOptions m_options;
+  std::shared_ptr<GlobalContext> m_context;
+  std::unique_ptr<Parser> m_parser;
+};
+
+/// If the file cannot be opened, the error is diagnosed and the returned
+/// parser has no syntax tree. Parsing stops after error_limit errors, 0 means
+/// that every error is reported. thread_count is the number of threads the
+/// function bodies are parsed on, and entry_points the functions whose
+/// bodies are parsed, with the ones they call, see Parser
+Parser parseFile(const char *path_to_file,
+                 FileStream::Backend backend = FileStream::Buffered,
+                 lex::Tokenizer::Mode mode = lex::Tokenizer::Streaming,
+                 unsigned error_limit = 20, unsigned thread_count = 1,
+                 std::vector<Symbol> entry_points = {});
+
+/// parse source that is already in memory, without going through a file
+Parser parseBuffer(std::string_view buffer, std::string name = "<buffer>",
+                   lex::Tokenizer::Mode mode = lex::Tokenizer::Streaming,
+                   unsigned error_limit = 20, unsigned thread_count = 1,
+                   std::vector<Symbol> entry_points = {});
 }; // namespace vcc
 
 #endif
@@ -2,11 +2,16 @@
 #define CORE_LEX_H
 
 #include "core/stream.h"
-#include <set>
-#include <unordered_map>
-#include <unordered_set>
+#include "core/symbol.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string_view>
 
 namespace vcc {
+namespace scan {
+struct KernelTable;
+};
 namespace lex {
 
 enum TokenType {
@@ -76,135 +81,307 @@ enum TokenType {
   Num
 };
 
+/// The spelling of every keyword and punctuation token. precedence is the
+/// binding strength of binary operators and 0 for everything else.
+struct KeywordInfo {
+  std::string_view spelling{};
+  TokenType type = Invalid;
+  int precedence = 0;
+};
+
+// clang-format off
+constexpr KeywordInfo keywords[] = {
+    {"function", FunctionDecl},
+    {"(", LeftParentheses},
+    {")", RightParentheses},
+    {"<", LessSign},
+    {">", GreaterSign},
+    {"[", LeftBracket},
+    {"]", RightBracket},
+    {"{", LeftBrace},
+    {"}", RightBrace},
+    {",", Comma},
+    {"while", While},
+    {"struct", Struct},
+    {"external", External},
+
+    {"if", If},
+    {"then", Then},
+    {"end", End},
+    {"deref", Deref},
+    {"ref", Ref},
+
+    // boolean stuff
+    {"eq", EqualKeyword, 1},
+    {"ne", NEquals, 1},
+    {"gt", GreaterThan, 1},
+    {"ge", GreaterEqual, 1},
+    {"le", LessEqual, 1},
+    {"lt", LessThan, 1},
+
+    // binary stuff
+    {"+", Add, 2},
+    {"-", Subtract, 2},
+    {"*", Multiply, 3},
+    {"/", Divide, 3},
+
+    {"int", Int},
+    {"float", Float},
+    {"long", Long},
+    {"short", Short},
+    {"array", Array},
+    {"bool", Bool},
+    {"gives", Gives},
+    {"cast", Cast},
+    {"char", Char},
+    {"void", Void},
+    {"ptr", Ptr},
+    {";", SemiColon},
+    {"=", Equal},
+    {".", Fullstop},
+    {"ret", Ret}};
+// clang-format on
+
+/// Perfect hash over the spellings in `keywords`, it only looks at the length,
+/// the first and the last character so nothing has to be allocated or
+/// scanned. If adding a keyword trips the static_assert below, pick new
+/// multipliers (or a larger table) that keep every keyword in its own slot.
+constexpr std::size_t KeywordTableSize = 128;
+constexpr std::size_t hashKeyword(std::string_view word) {
+  if (word.empty())
+    return 0;
+
+  return (word.size() + static_cast<unsigned char>(word.front()) * 6 +
+          static_cast<unsigned char>(word.back()) * 37) %
+         KeywordTableSize;
+}
+
+struct KeywordTable {
+  std::array<KeywordInfo, KeywordTableSize> slots{};
+  std::array<bool, 256> is_one_character{};
+  std::array<int, Num> precedence{};
+  bool has_collision = false;
+};
+
+constexpr KeywordTable buildKeywordTable() {
+  KeywordTable table{};
+  for (const KeywordInfo &keyword : keywords) {
+    KeywordInfo &slot = table.slots[hashKeyword(keyword.spelling)];
+    if (slot.type != Invalid)
+      table.has_collision = true;
+    slot = keyword;
+
+    if (keyword.spelling.size() == 1)
+      table.is_one_character[static_cast<unsigned char>(
+          keyword.spelling.front())] = true;
+    table.precedence[keyword.type] = keyword.precedence;
+  }
+  return table;
+}
+
+constexpr inline KeywordTable keyword_table = buildKeywordTable();
+static_assert(!keyword_table.has_collision,
+              "two keywords share a slot, hashKeyword must be retuned");
+
+/// The keyword spelled word, Invalid if word is not a keyword
+constexpr TokenType lookupKeyword(std::string_view word) {
+  const KeywordInfo &slot = keyword_table.slots[hashKeyword(word)];
+  return slot.spelling == word ? slot.type : Invalid;
+}
+
+/// True if c is a token on its own, like '(' or '+'
+constexpr bool isOneCharacterToken(char c) {
+  return keyword_table.is_one_character[static_cast<unsigned char>(c)];
+}
+
+/// The precedence of a binary operator, 0 if type is not one
+constexpr int getPrecedence(TokenType type) {
+  return keyword_table.precedence[type];
+}
+
+/// A token is its type, the offset of its first character in the file, and a
+/// 32 bit payload. The payload of an Identifier or a String is its interned
+/// Symbol. The payload of an IntegerLiteral is the value itself if it fits in
+/// 31 bits, and an index into a process wide table of larger literals
+/// otherwise. Tokens are small enough to be passed around by value, the
+/// Tokenizer turns the offset into a FilePos when it is needed
 struct Token {
 public:
   // error state
   Token();
 
-  // for identifier
-  Token(std::string &&string_litearl, FilePos pos);
+  // for type like Parentheses, Invalid, EndOfFile, and keywords
+  Token(TokenType type, long offset);
 
-  // for IntegerLiteral
-  Token(long long integer_litearl, FilePos pos);
+  // for Identifier and String
+  Token(TokenType type, Symbol spelling, long offset);
 
-  // for type like Parentheses, Invalid, EndOfFile, and keywords
-  Token(TokenType type, FilePos pos);
+  // for IntegerLiteral
+  Token(long long integer_literal, long offset);
 
-  Token(TokenType type, std::string &string_literal, FilePos pos);
+  /// a token from the fields stored in a TokenStream
+  static Token fromParts(TokenType type, std::uint32_t offset,
+                         std::uint32_t payload);
 
   void dump() const;
   TokenType getType() const;
+  /// the spelling of an Identifier, or the content of a String
   const std::string &getStringLiteral() const;
+  Symbol getSymbol() const;
   long long getIntegerLiteral() const;
   bool isBinaryOperator() const;
-  FilePos getPos() const;
+  long getOffset() const;
+  std::uint32_t getPayload() const;
   bool isTypeQualification() const;
 
+  /// set in the payload of an IntegerLiteral that is kept in the literal table
+  static constexpr std::uint32_t LargeLiteralBit = 1u << 31;
+
+  /// Forgets the literals that did not fit in a payload, like
+  /// Symbol::clearTable(), with the same restrictions
+  static void clearLiteralTable();
+
 private:
-  FilePos pos = {1, 1, 0};
-  TokenType type;
+  std::uint32_t offset = 0;
+  std::uint32_t payload = 0;
+  std::uint8_t type = Invalid;
+};
+static_assert(sizeof(Token) <= 16, "a Token must stay small");
+
+/// Every token of a file, lexed in one pass and stored as parallel arrays of
+/// the fields of a Token, so walking the types does not touch anything else.
+class TokenStream {
+public:
+  void push(const Token &token);
+
+  /// push every token of other, in order
+  void append(const TokenStream &other);
+
+  /// Replace the tokens [first, last) by the tokens of replacement, and move
+  /// the tokens after them by shift characters
+  void splice(int first, int last, const TokenStream &replacement, long shift);
 
-  std::string string_literal;
-  // FIXME: change this into int64_t
-  long long integer_literal;
+  /// the number of tokens, including the trailing EndOfFile
+  int size() const;
+
+  TokenType getType(int index) const;
+  long getOffset(int index) const;
+
+  /// the index of the first token at or after offset
+  int findToken(long offset) const;
+  const std::string &getStringLiteral(int index) const;
+  Symbol getSymbol(int index) const;
+  long long getIntegerLiteral(int index) const;
+
+  /// build the Token at index
+  Token getToken(int index) const;
+
+private:
+  std::vector<std::uint8_t> m_types;
+  std::vector<std::uint32_t> m_offsets;
+  std::vector<std::uint32_t> m_payloads;
+};
+
+/// removed_length characters at offset were replaced by inserted
+struct TextEdit {
+  long offset = 0;
+  long removed_length = 0;
+  std::string_view inserted;
 };
 
 class Tokenizer {
 public:
-  Tokenizer(FileStream &stream);
+  enum Mode {
+    /// tokens are lexed one at a time as they are asked for
+    Streaming,
+    /// the whole file is lexed into a TokenStream up front, and the tokenizer
+    /// walks it by index
+    PreTokenized,
+  };
+
+  Tokenizer(FileStream &stream, Mode mode = Streaming);
+
+  /// a PreTokenized tokenizer over tokens that were already lexed, starting at
+  /// the token at index begin
+  Tokenizer(FileStream &stream, std::shared_ptr<const TokenStream> tokens,
+            int begin = 0);
+
+  /// Lex every token of stream. A Buffered stream is split at top level
+  /// declarations and the pieces are lexed on thread_count threads, 0 picks
+  /// one thread per ParallelChunkSize bytes, up to the number of cores
+  static std::shared_ptr<TokenStream> tokenize(FileStream &stream,
+                                               unsigned thread_count = 0);
+  static constexpr long ParallelChunkSize = 1 << 20;
+
+  /// Update the tokens of a file after edit. source is the whole file with
+  /// the edit applied. Only the tokens around the edit are lexed again, the
+  /// ones after it are moved. Returns the number of tokens that were lexed
+  static int relex(TokenStream &tokens, std::string_view source,
+                   const TextEdit &edit);
 
   // consume token
-  const Token next();
-  const Token next(int n);
+  const Token &next();
 
-  // don't consume token
-  const Token peek();
+  // don't consume token, returns the token n after the current one. The
+  // reference is valid until the next token is consumed
+  const Token &next(int n);
+  const Token &peek();
   const Token &current();
 
+  /// the most tokens that can be looked ahead with next(n)
+  static constexpr int LookaheadSize = 4;
+
   // consume the token
   void consume();
   TokenType getNextType();
   TokenType getCurrentType();
+
+  /// the position of the current token
   FilePos getPos();
+  /// the offset of the current token in the file
+  long getOffset();
 
-  std::string getLine(const FilePos &pos);
+  /// the type of peek(), without building the token when PreTokenized
+  TokenType peekType();
 
-private:
-  const static inline std::unordered_map<std::string, TokenType> keyword_map = {
-      {"function", FunctionDecl},
-      {"(", LeftParentheses},
-      {")", RightParentheses},
-      {"<", LessSign},
-      {">", GreaterSign},
-      {"[", LeftBracket},
-      {"]", RightBracket},
-      {"{", LeftBrace},
-      {"}", RightBrace},
-      {",", Comma},
-      {"while", While},
-      {"struct", Struct},
-      {"external", External},
-
-      {"if", If},
-      {"then", Then},
-      {"end", End},
-      {"deref", Deref},
-      {"ref", Ref},
-
-      // boolean stuff
-      {"eq", EqualKeyword},
-      {"ne", NEquals},
-      {"gt", GreaterThan},
-      {"ge", GreaterEqual},
-      {"le", LessEqual},
-      {"lt", LessThan},
-
-      // binary stuff
-
-      {"int", Int},
-      {"float", Float},
-      {"long", Long},
-      {"short", Short},
-      {"array", Array},
-      {"bool", Bool},
-      {"gives", Gives},
-      {"cast", Cast},
-      {"char", Char},
-      {"void", Void},
-      {"ptr", Ptr},
-      {";", SemiColon},
-      {"=", Equal},
-      {".", Fullstop},
-      {"ret", Ret},
-      {"+", Add},
-      {"/", Divide},
-      {"-", Subtract},
-      {"*", Multiply}};
-
-  static std::unordered_set<char>
-  getOneCharacterToken(const std::unordered_map<std::string, TokenType> &map) {
-    std::unordered_set<char> one_symbol{};
-    for (auto it = map.begin(), ie = map.end(); it != ie; ++it) {
-      if (it->first.length() == 1)
-        one_symbol.insert(it->first[0]);
-    }
-    return one_symbol;
-  }
+  /// PreTokenized only. The index of the current token in the TokenStream,
+  /// moving it with setIndex lets the caller backtrack for free
+  int getIndex() const;
+  void setIndex(int index);
+  const std::shared_ptr<const TokenStream> &getTokenStream() const;
 
-  const static inline std::unordered_set<char> one_character_token =
-      getOneCharacterToken(keyword_map);
-  const static inline std::set<char> binary_operator{'+'};
-  static bool isKeyword(const std::string &keyword);
-  static bool isBinary(const std::string &keyword);
-  static TokenType getKeyword(const std::string &keyword);
+  std::string getLine(const FilePos &pos);
+  /// the name of the file being lexed
+  const std::string &getName() const;
 
+private:
   Token readOneToken();
   void removeWhiteSpace();
 
+  /// readOneToken for the Buffered backend, skips white space, comments and
+  /// words with the kernels in scan.h
+  Token readOneBufferedToken();
+
   /// FIXME: this really is a trust me, I am always valid lifetime
   FileStream &m_file;
+  /// the scan kernel, resolved once instead of on every token
+  const scan::KernelTable &m_kernel;
 
   Token m_current_token;
+
+  // Only set when PreTokenized. m_current_token is built from m_tokens by
+  // current()
+  std::shared_ptr<const TokenStream> m_tokens;
+  int m_index = 0;
+
+  // Tokens already lexed by peek() and next(n) but not consumed yet, so that
+  // looking ahead never has to seek back in the stream.
+  // m_lookahead[(m_lookahead_begin + i) % LookaheadSize] is the (i + 1)th
+  // token after m_current_token. When PreTokenized, m_lookahead[n - 1] is
+  // where next(n) builds its token
+  std::array<Token, LookaheadSize> m_lookahead;
+  int m_lookahead_begin = 0;
+  int m_lookahead_count = 0;
 };
 }; // namespace lex
 }; // namespace vcc
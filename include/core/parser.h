@@ -7,12 +7,24 @@
 #include "core/sema.h"
 
 #include "core/type.h"
+#include <unordered_map>
 
 namespace vcc {
 class Parser {
 public:
-  Parser(ContextHolder context);
-
+  /// With a thread_count other than 1 the function bodies are parsed on that
+  /// many threads, 0 picks one per core. This needs a Buffered stream.
+  ///
+  /// With entry_points, only the bodies of those functions and of the ones
+  /// they call, directly or not, are parsed. The other functions are left out
+  /// of the syntax tree, their bodies are only skipped over.
+  ///
+  /// Either way the file is lexed up front whatever the mode
+  Parser(ContextHolder context,
+         lex::Tokenizer::Mode mode = lex::Tokenizer::Streaming,
+         unsigned thread_count = 1, std::vector<Symbol> entry_points = {});
+
+  /// parses the source, only the first call of a parser does anything
   void start();
   const std::vector<Statement *> &getSyntaxTree();
   ContextHolder getHolder();
@@ -30,7 +42,57 @@ private:
   Statement *buildFunctionDecl();
   FunctionArgLists *buildFunctionArgList();
 
+  /// everything of a function declaration before its body
+  struct FunctionHeader {
+    Symbol name;
+    Type *return_type;
+    FunctionArgLists *arg_list;
+    SourceLocation locus;
+  };
+  /// parses up to and including the '{' of the body
+  bool buildFunctionHeader(FunctionHeader &header);
+  /// parses the statements after the '{' and the closing '}'
+  Statement *buildFunctionBody(const FunctionHeader &header);
+
+  /// A function body that is left for parseBodies. The errors of the
+  /// declarations before it, and of the body itself, are kept until all the
+  /// bodies are parsed so that they are reported in source order
+  struct PendingBody {
+    FunctionHeader header;
+    /// the index of the first token after '{'
+    int begin;
+    /// where the declaration goes in m_top_level_statements
+    std::size_t slot;
+    /// the errors of the first pass before the body
+    unsigned errors_before;
+    DiagnosticDriver preceding;
+    DiagnosticDriver diagnostics;
+    Statement *declaration = nullptr;
+    /// the functions called in the body, once it is parsed
+    std::vector<Symbol> callees;
+  };
+  /// true if bodies are skipped by the first pass and parsed afterwards
+  bool defersBodies() const;
+  /// parses the header, and skips the body for now
+  bool deferFunctionDecl();
+  /// parses the pending bodies at indices, on m_thread_count threads
+  void parseBodies(const std::vector<int> &indices);
+  /// parses the bodies reachable from m_entry_points, level by level
+  void parseReachableBodies();
+  /// puts the parsed bodies in the tree and reports their errors, in source
+  /// order
+  void mergeBodies();
+
+  /// a parser for another thread, with its own cursor over the tokens of
+  /// parent and its own arena
+  Parser(const Parser &parent, ASTContext &ast);
+
   // Statements
+  /// parses statements up to terminator, which is left for the caller. A
+  /// broken statement is diagnosed and skipped, so that every error of a
+  /// block is reported in one run
+  void buildStatements(std::vector<Statement *> &statements,
+                       lex::TokenType terminator);
   Statement *buildAssignmentStatement();
   Statement *buildReturnStatement();
   Statement *buildStatement();
@@ -62,32 +124,46 @@ private:
   };
   inline ErrorResult logError(const std::string &message);
 
-  // for binary expression
-  // clang-format off
-  const static inline std::unordered_map<lex::TokenType, int> precedence_level={
-          // eq, ne, gt, ge, lt, le
-          {lex::EqualKeyword, 1},
-          {lex::NEquals, 1},
-          {lex::GreaterThan, 1},
-          {lex::GreaterEqual, 1},
-          {lex::LessThan, 1},
-          {lex::LessEqual, 1},
-
-          {lex::Add, 2},
-          {lex::Subtract, 2},
-
-          {lex::Multiply, 3},
-          {lex::Divide, 3},
-  };
-  // clang-format on
+  /// panic mode recovery, skips to the next ';' (which is eaten), 'end', '}'
+  /// or top level keyword
+  void synchronizeStatement();
+  /// skips past the next '}' or up to the next top level keyword
+  void synchronizeTopLevel();
+  /// no more diagnostics are wanted, parsing stops
+  bool shouldStop() const;
+
+  /// allocates a node or a type in the arena of the compilation
+  template <typename T, typename... Args> T *create(Args &&...args) {
+    return m_ast->create<T>(std::forward<Args>(args)...);
+  }
+
+  /// the location of the current token, or of token
+  SourceLocation getLocation();
+  SourceLocation getLocation(const lex::Token &token);
 
   ContextHolder m_context;
+  // the source being parsed
+  SourceManager::FileID m_file;
   lex::Tokenizer m_tokenizer;
   Sema m_actions;
 
+  // the arena and the diagnostics of this thread, the ones of the context
+  // unless parsing in parallel
+  ASTContext *m_ast;
+  DiagnosticDriver *m_diagnostics;
+  unsigned m_thread_count;
+  std::vector<Symbol> m_entry_points;
+  // where the functions called by the body being parsed are recorded, if
+  // anywhere
+  std::vector<Symbol> *m_callees = nullptr;
+  bool m_started = false;
+
   // Store the computation results
   std::vector<Statement *> m_top_level_statements;
-  std::unordered_map<std::string, StructType *> m_struct_defs;
+  std::unordered_map<Symbol, StructType *> m_struct_defs;
+  std::vector<PendingBody> m_pending_bodies;
+  // the errors of the bodies parsed by earlier calls to parseBodies
+  unsigned m_body_errors = 0;
 };
 }; // namespace vcc
 
@@ -0,0 +1,48 @@
+#ifndef CORE_SCAN_H
+#define CORE_SCAN_H
+
+namespace vcc {
+namespace scan {
+/// Kernels used to scan runs of characters in a buffer. The SIMD kernels look
+/// at 16 (SSE2) or 32 (AVX2) characters at a time, the best one the cpu
+/// supports is picked at runtime
+enum Kernel { Scalar, SSE2, AVX2 };
+
+/// the fastest kernel the cpu can run
+Kernel getBestKernel();
+
+/// the kernel currently used by the functions below
+Kernel getKernel();
+
+/// Only used for testing and benchmarking. Returns false, and changes nothing,
+/// if the cpu cannot run kernel. A KernelTable that was already resolved keeps
+/// its kernel
+bool setKernel(Kernel kernel);
+
+/// The functions of one kernel. A loop resolves the table once and calls
+/// through it, the free functions below look the current kernel up on every
+/// call
+struct KernelTable {
+  const char *(*skip_white_space)(const char *begin, const char *end);
+  const char *(*find_new_line)(const char *begin, const char *end);
+  const char *(*find_token_end)(const char *begin, const char *end);
+};
+
+/// the functions of the current kernel
+const KernelTable &getKernelTable();
+
+/// the first character in [begin, end) that is neither ' ' nor '\n', end if
+/// there is none
+const char *skipWhiteSpace(const char *begin, const char *end);
+
+/// the first '\n' in [begin, end), end if there is none
+const char *findNewLine(const char *begin, const char *end);
+
+/// the first character in [begin, end) that cannot be part of an identifier,
+/// keyword or integer: ' ', '\n', '\0' or a one character token like '('.
+/// end if there is none
+const char *findTokenEnd(const char *begin, const char *end);
+}; // namespace scan
+}; // namespace vcc
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef CORE_SEMA_H
 #define CORE_SEMA_H
 
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "ast.h"
 #include "type.h"
@@ -9,19 +12,60 @@
 namespace vcc {
 class Parser;
 
-/// This entire idea is horrible for performance!
-/// In a perfect world, this should be during parser
-/// And not need to duplicate so much unnecessary code.
+/// Checks a syntax tree once it is parsed, before any code is generated.
+/// Every expression gets its type here, and every use of a variable or a
+/// function is bound to its declaration. Code generation only reads them, and
+/// every type error is diagnosed here. Constant expressions are folded here
+/// too, so that code generation emits their value instead of the operations
 class Sema {
 public:
   Sema();
 
+  /// checks the functions of syntax_tree in order, returns false if an error
+  /// was diagnosed
+  bool analyze(ContextHolder holder,
+               const std::vector<Statement *> &syntax_tree);
+
   /// Perform a list of checks applies to function
   /// returns ture if passes, false otherwise
   bool checkFunction(FunctionDecl *decl);
 
 private:
-  ///
+  void checkStatements(const std::vector<Statement *> &statements);
+  void checkStatement(Statement *statement);
+  void checkCondition(Expression *condition);
+
+  /// sets the type of expression and returns it, nullptr if it is ill formed
+  Type *checkExpression(Expression *expression);
+  Type *computeType(Expression *expression);
+  Type *checkBinaryExpression(BinaryExpression *expression);
+  Type *checkCallExpr(CallExpr *expression);
+  Type *checkMemberAccess(MemberAccessExpression *expression);
+  Type *checkArrayAccess(ArrayAccessExpression *expression);
+  Type *checkDeRef(DeRefExpression *expression);
+
+  /// folds a well typed expression whose operands are already folded, or
+  /// simplifies it to one of its operands
+  void fold(Expression *expression);
+  void foldBinaryExpression(BinaryExpression *expression);
+  void foldCast(CastExpression *expression);
+  const ConstantValue *createConstant(std::optional<ConstantValue> value);
+  /// the type a posfix expression accesses into when its parent is parent
+  Type *getPosfixBaseType(LocatorExpression *parent);
+
+  /// the variables visible in the innermost scope
+  void pushScope();
+  void popScope();
+  void declare(const ASTBase *at, TypeInfo *variable);
+  /// nullptr if there is no such variable
+  TypeInfo *lookup(const ASTBase *at, Symbol name);
+
+  void diag(const ASTBase *at, const std::string &message);
+
+  ContextHolder m_context;
+  // the functions checked so far, a function can only call those
+  std::unordered_map<Symbol, FunctionDecl *> m_functions;
+  std::vector<std::unordered_map<Symbol, TypeInfo *>> m_scopes;
 };
 
 }; // namespace vcc
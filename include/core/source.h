@@ -0,0 +1,75 @@
+#ifndef CORE_SOURCE_H
+#define CORE_SOURCE_H
+
+#include "core/stream.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vcc {
+/// A position in one of the sources of a SourceManager. The sources are laid
+/// out one after the other in a single address space, and a location is an
+/// offset into it. The file, row and column are only worked out when a
+/// diagnostic is printed. 0 is the invalid location
+class SourceLocation {
+public:
+  SourceLocation() = default;
+
+  static SourceLocation fromRaw(std::uint32_t raw);
+  std::uint32_t getRaw() const;
+  bool isValid() const;
+
+  /// the location offset characters further into the same source
+  SourceLocation getLocWithOffset(long offset) const;
+
+  bool operator==(SourceLocation other) const;
+  bool operator!=(SourceLocation other) const;
+  bool operator<(SourceLocation other) const;
+
+private:
+  std::uint32_t m_raw = 0;
+};
+
+/// Owns every source of a compilation, such as a prelude, generated code and
+/// the main file
+class SourceManager {
+public:
+  using FileID = int;
+
+  /// Sources that cannot be opened are still added, getStream(id).is_open()
+  /// tells if they could be. A source whose size is not known up front, such
+  /// as stdin, takes the rest of the address space and must be added last
+  FileID addFile(const char *filename,
+                 FileStream::Backend backend = FileStream::Buffered);
+  FileID addBuffer(std::string_view content, std::string name);
+
+  FileStream &getStream(FileID id);
+  int getFileCount() const;
+
+  /// the location of the character at offset in the source id
+  SourceLocation getLocation(FileID id, long offset) const;
+  FileID getFileID(SourceLocation loc) const;
+  long getFileOffset(SourceLocation loc) const;
+
+  // resolving a location, only done for diagnostics
+  FilePos getPos(SourceLocation loc);
+  std::string getLine(SourceLocation loc);
+  const std::string &getName(SourceLocation loc) const;
+
+private:
+  FileID addStream(std::unique_ptr<FileStream> stream);
+
+  struct Entry {
+    std::uint32_t start;
+    std::unique_ptr<FileStream> stream;
+  };
+  // in the order they were added, so also sorted by start
+  std::vector<Entry> m_entries;
+  // 0 is the invalid location
+  std::uint64_t m_next_start = 1;
+};
+} // namespace vcc
+
+#endif
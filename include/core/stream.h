@@ -4,6 +4,8 @@
 #include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace vcc {
@@ -24,7 +26,33 @@ bool operator==(const FilePos &lhs, const FilePos &rhs);
 /// abstractions above std::ifstream
 class FileStream {
 public:
-  FileStream(const char *filename);
+  /// How the content of the file is read
+  enum Backend {
+    /// The whole file is mapped into memory once (or read into a single
+    /// buffer if it cannot be mapped), every operation is a pointer operation
+    Buffered,
+    /// One std::fread per character. This is the original implementation,
+    /// kept around so that the two can be timed against each other
+    Stdio,
+    /// Read in chunks of ChunkSize as the content is consumed. Only the last
+    /// BacktrackWindow characters before the current one can be sought back
+    /// to. Used for stdin and pipes, which can neither be mapped nor rewound
+    Streamed,
+  };
+
+  static constexpr long ChunkSize = 64 * 1024;
+  static constexpr long BacktrackWindow = 4096;
+
+  /// filename "-" is stdin. Inputs that are not regular files are always
+  /// Streamed, whatever the backend asked for. If the file cannot be opened
+  /// is_open() is false, and the stream behaves like an empty file
+  FileStream(const char *filename, Backend backend = Buffered);
+
+  /// A Buffered stream over source that is already in memory, such as
+  /// generated code. The content is copied, name is what the source is
+  /// called in messages
+  FileStream(std::string_view content, std::string name);
+  ~FileStream();
 
   // Remove copy constructor, because this is unsafe
   FileStream(const FileStream &other) = delete;
@@ -49,12 +77,44 @@ public:
 
   FilePos getPos();
 
+  /// the position of an arbitrary byte offset in the file
+  FilePos getPos(long pos);
+
   /// is the file open?
   bool is_open();
 
+  /// the file name, or the name given to an in-memory source
+  const std::string &getName() const;
+
+  Backend getBackend() const;
+
+  /// Buffered only. The whole content of the file, so that the lexer can scan
+  /// it directly instead of one get() at a time
+  const char *getBuffer() const;
+  long getSize() const;
+
+  /// the line that contains pos, without the newline. Streamed only has the
+  /// part of the line that is still in the window, which may be nothing
   std::string getLine(long pos);
 
 private:
+  void openBuffer(const char *filename);
+  /// points the Buffered backend at m_storage
+  void useStorage();
+  void buildLineTable();
+  /// Stdio only. Reads the file past the part the line table covers, up to
+  /// pos, leaving the file position anywhere
+  void extendLineTable(long pos);
+
+  void openStream(const char *filename);
+  /// Streamed only. Reads one more chunk, dropping what is not needed
+  /// anymore: everything before keep_from and before the backtrack window.
+  /// Returns false at the end of the input
+  bool readChunk(long keep_from);
+
+  Backend m_backend;
+  std::string m_name;
+
   /// check if we are at the end of file
   bool m_is_end_of_file = false;
 
@@ -68,8 +128,38 @@ private:
   void saveState();
   void restoreState();
 
-  std::FILE *m_file;
+  // only used by the Stdio and Streamed backend
+  std::FILE *m_file = nullptr;
+
+  // only used by the Buffered backend. [m_begin, m_end) is the content of
+  // the file, and m_current is the next character to be read
+  const char *m_begin = nullptr;
+  const char *m_current = nullptr;
+  const char *m_end = nullptr;
+  // non null if the content is mapped, otherwise the content is in m_storage
+  void *m_mapping = nullptr;
+  std::size_t m_mapping_size = 0;
+  std::vector<char> m_storage;
+  // m_line_starts[i] is the offset of the first character of row i + 1. Built
+  // once when the file is opened so that positions can be found with a binary
+  // search instead of rereading the file
+  std::vector<long> m_line_starts;
+
+  // only used by the Stdio backend, the Buffered backend computes positions
+  // from m_line_starts on demand
   FilePos m_pos = {1, 1, 0};
+  // the Stdio backend extends m_line_starts as it reads, it covers the
+  // offsets before m_line_table_end. seekg, getPos and getLine extend it too
+  // when they go further, so the file is never reread from the start
+  long m_line_table_end = 0;
+
+  // only used by the Streamed backend. m_storage holds the characters at
+  // offsets [m_window_offset, m_window_offset + m_storage.size()), and
+  // m_stream_pos is the offset of the next character to be read.
+  // m_line_starts is extended as chunks are read
+  long m_window_offset = 0;
+  long m_stream_pos = 0;
+  bool m_is_stream_done = false;
 };
 
 }; // namespace vcc
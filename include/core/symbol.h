@@ -0,0 +1,65 @@
+#ifndef CORE_SYMBOL_H
+#define CORE_SYMBOL_H
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace vcc {
+/// An interned name. Every spelling is stored once in a process wide table,
+/// and a Symbol is its 32 bit index into that table. Two Symbols are equal
+/// iff their spellings are, so names are compared and hashed as integers.
+///
+/// Interning is thread safe, and str() takes no lock. The table lives until
+/// the process exits unless clearTable() is called, so the reference returned
+/// by str() stays valid until then
+class Symbol {
+public:
+  /// the empty name
+  Symbol() = default;
+
+  /// the Symbol spelled spelling, adding it to the table the first time
+  static Symbol intern(std::string_view spelling);
+
+  const std::string &str() const;
+  std::uint32_t getID() const { return m_id; }
+  bool empty() const { return m_id == 0; }
+
+  friend bool operator==(Symbol lhs, Symbol rhs) {
+    return lhs.m_id == rhs.m_id;
+  }
+  friend bool operator!=(Symbol lhs, Symbol rhs) {
+    return lhs.m_id != rhs.m_id;
+  }
+
+  /// the order in which the symbols were interned, not alphabetical
+  friend bool operator<(Symbol lhs, Symbol rhs) { return lhs.m_id < rhs.m_id; }
+
+  /// Only used by TokenStream, which stores symbols as their ids
+  static Symbol fromID(std::uint32_t id);
+
+  /// Forgets every spelling but the empty one, for a long running process
+  /// that compiles many times. No other thread may intern or read a symbol
+  /// meanwhile, and no Symbol, Token or syntax tree made before may be used
+  /// afterwards
+  static void clearTable();
+
+private:
+  explicit Symbol(std::uint32_t id) : m_id(id) {}
+
+  std::uint32_t m_id = 0;
+};
+
+std::ostream &operator<<(std::ostream &os, Symbol symbol);
+
+}; // namespace vcc
+
+template <> struct std::hash<vcc::Symbol> {
+  std::size_t operator()(vcc::Symbol symbol) const {
+    return std::hash<std::uint32_t>()(symbol.getID());
+  }
+};
+
+#endif
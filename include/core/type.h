@@ -1,21 +1,29 @@
 #ifndef CORE_TYPE_H
 #define CORE_TYPE_H
 
+#include "core/ast_context.h"
 #include "core/context.h"
+#include "core/symbol.h"
 #include "core/util.h"
 
 #include <llvm/IR/Type.h>
 #include <memory.h>
+#include <mutex>
 #include <optional>
+#include <unordered_map>
 
 
 namespace vcc {
-// FIXME: A lot of the time Type is immutable
-// Therefore maybe we could just return a pointer
-// by heap allocating once and save a lot of save.
-// we might need something like a map to keep track
+/// Types are unique within a compilation, the TypeContext hands out a single
+/// instance of each, so two types are the same if they are the same object
 class Type {
 public:
+  /// what a Type is, so that checking for it does not need a dynamic_cast
+  enum TypeKind { BuiltinKind, PointerKind, ArrayKind, StructKind, VoidKind };
+
+  explicit Type(TypeKind kind);
+  TypeKind getTypeKind() const { return m_kind; }
+
   virtual llvm::Type *getType(ContextHolder holder);
   virtual void dump();
 
@@ -28,15 +36,20 @@ public:
   bool isVoid() const;
   bool isVoidPtr() const;
 
+  /// only meaningful for types of the same TypeContext
   static bool isSame(Type *lhs, Type *rhs);
 
 private:
+  TypeKind m_kind;
 };
 
 class ArrayType : public Type {
 public:
   // Creating an array of base*, with these amount of count
   ArrayType(Type *base, int count);
+  static bool classof(const Type *type) {
+    return type->getTypeKind() == ArrayKind;
+  }
 
   Type *getBase();
   int getCount();
@@ -53,6 +66,9 @@ private:
 class PointerType : public Type {
 public:
   PointerType(Type *m_pointee);
+  static bool classof(const Type *type) {
+    return type->getTypeKind() == PointerKind;
+  }
 
   Type *getPointee();
   const Type *getPointee() const;
@@ -62,6 +78,7 @@ public:
 
 private:
   Type *m_pointee;
+  llvm::Type *m_llvm_type = nullptr;
 };
 
 class BuiltinType : public Type {
@@ -69,6 +86,9 @@ public:
   enum Builtin { Int, Float, Char, Bool, Long, Short };
 
   BuiltinType(Builtin builtin);
+  static bool classof(const Type *type) {
+    return type->getTypeKind() == BuiltinKind;
+  }
   Builtin getKind() const;
   bool isFloat() const;
 
@@ -96,37 +116,101 @@ public:
   struct Element {
     // FIXME: this can be deduced from array index. Why do we need this?
     int field_num;
-    std::string name;
+    Symbol name;
     Type *type;
   };
-  StructType(const std::vector<Element> &elements, const std::string &name);
+  StructType(const std::vector<Element> &elements, Symbol name);
+  static bool classof(const Type *type) {
+    return type->getTypeKind() == StructKind;
+  }
   virtual llvm::Type *getType(ContextHolder holder) override;
   virtual void dump() override;
 
-  std::optional<Element> getElement(const std::string &name);
+  bool hasElement(Symbol name) const;
+  /// the element must exist
+  const Element &getElement(Symbol name) const;
   const std::vector<Element> &getElements() const;
-  const std::string &getName() const;
+  Symbol getName() const;
+
+  /// Where the element field_num starts in the struct and how many bytes it
+  /// takes, in the data layout of the module. They are computed for every
+  /// element on the first query, the layout must not change afterwards
+  uint64_t getElementOffset(ContextHolder holder, int field_num);
+  uint64_t getElementSize(ContextHolder holder, int field_num);
+  /// the size of the whole struct, with its padding
+  uint64_t getSize(ContextHolder holder);
 
 private:
+  void computeLayout(ContextHolder holder);
+
   std::vector<Element> m_elements;
-  std::string m_name;
+  // the index of each element in m_elements, by name
+  std::unordered_map<Symbol, int> m_element_index;
+  Symbol m_name;
   llvm::StructType *m_llvm_type = nullptr;
+
+  // filled by computeLayout
+  std::vector<uint64_t> m_offsets;
+  std::vector<uint64_t> m_sizes;
+  uint64_t m_size = 0;
 };
 
 class VoidType : public Type {
 public:
+  VoidType();
+  static bool classof(const Type *type) {
+    return type->getTypeKind() == VoidKind;
+  }
   virtual llvm::Type *getType(ContextHolder holder);
   virtual void dump();
 
 private:
+  llvm::Type *m_llvm_type = nullptr;
 };
 
-/// FIXME: it seems that we need to better organize
-/// header files in the future!
-/// used by ast.h implementation
-struct TypeInfo {
-  Type *type;
-  std::string name;
+/// Owns the types of a compilation and makes sure that each of them exists
+/// once, so that they can be compared by address and their llvm::Type cached.
+/// Function bodies are parsed on several threads, so it can be used from any
+/// of them
+class TypeContext {
+public:
+  TypeContext();
+
+  TypeContext(const TypeContext &other) = delete;
+  TypeContext &operator=(const TypeContext &other) = delete;
+
+  BuiltinType *getBuiltinType(BuiltinType::Builtin builtin);
+  VoidType *getVoidType();
+  PointerType *getPointerType(Type *pointee);
+  ArrayType *getArrayType(Type *base, int count);
+  /// structs are told apart by their name, every definition is a new type
+  StructType *createStructType(const std::vector<StructType::Element> &elements,
+                               Symbol name);
+  /// prints the memory of the type arena, kept apart from the syntax tree
+  void printStats(std::ostream &os) const;
+
+private:
+  struct ArrayKey {
+    Type *base;
+    int count;
+    bool operator==(const ArrayKey &other) const {
+      return base == other.base && count == other.count;
+    }
+  };
+  struct ArrayKeyHash {
+    std::size_t operator()(const ArrayKey &key) const {
+      return std::hash<Type *>()(key.base) ^ std::hash<int>()(key.count);
+    }
+  };
+
+  // the builtins and void are created up front and never change, only the
+  // maps need the lock
+  mutable std::mutex m_mutex;
+  ASTContext m_arena;
+  std::vector<BuiltinType *> m_builtins;
+  VoidType *m_void;
+  std::unordered_map<Type *, PointerType *> m_pointers;
+  std::unordered_map<ArrayKey, ArrayType *, ArrayKeyHash> m_arrays;
 };
 }; // namespace vcc
 #endif
@@ -1,58 +1,67 @@
 #ifndef CORE_UTIL_H
 #define CORE_UTIL_H
 
-#ifndef _WIN32
-#include <cxxabi.h>
-#endif
-#include <memory>
 #include <string>
-#include <typeinfo>
+#include <type_traits>
 
 #include "core/ast.h"
 
 namespace vcc {
-// Returns the demangled name of the class
+// Returns the name of the class
 inline std::string getASTClassName(ASTBase *node) {
   if (!node)
     return "null";
 
-  if (dynamic_cast<ConstantExpr *>(node))
+  switch (node->getCode()) {
+  case code::FunctionArgLists:
+    return "FunctionArgLists";
+  case code::CallStatement:
+    return "CallStatement";
+  case code::FunctionDecl:
+    return "FunctionDecl";
+  case code::AssignmentStatement:
+    return "AssignmentStatement";
+  case code::ReturnStatement:
+    return "ReturnStatement";
+  case code::DeclarationStatement:
+    return "DeclarationStatement";
+  case code::IfStatement:
+    return "IfStatement";
+  case code::WhileStatement:
+    return "WhileStatement";
+  case code::ConstantExpr:
     return "ConstantExpr";
-  if (dynamic_cast<IdentifierExpr *>(node))
-    return "IdentifierExpr";
-  if (dynamic_cast<CallExpr *>(node))
+  case code::CallExpr:
     return "CallExpr";
-  if (dynamic_cast<BinaryExpression *>(node))
+  case code::BinaryExpression:
     return "BinaryExpression";
-  if (dynamic_cast<ReturnStatement *>(node))
-    return "ReturnStatement";
-  if (dynamic_cast<AssignmentStatement *>(node))
-    return "AssignmentStatement";
-  if (dynamic_cast<FunctionDecl *>(node))
-    return "FunctionDecl";
-
-#ifndef _WIN32
-  const std::type_info &ti = typeid(*node);
-  int status;
-  std::unique_ptr<char, void (*)(void *)> demangled(
-      abi::__cxa_demangle(ti.name(), nullptr, nullptr, &status), std::free);
-
-  return (status == 0 && demangled) ? demangled.get() : ti.name();
-#else 
-  return "windows - unknown";
-#endif
+  case code::CastExpression:
+    return "CastExpression";
+  case code::IdentifierExpr:
+    return "IdentifierExpr";
+  case code::MemberAccessExpression:
+    return "MemberAccessExpression";
+  case code::ArrayAccessExpression:
+    return "ArrayAccessExpression";
+  case code::DeRefExpression:
+    return "DeRefExpression";
+  case code::RefExpression:
+    return "RefExpression";
+  case code::StringLiteral:
+    return "StringLiteral";
+  }
+  return "unknown";
 };
 
-template <typename T, typename U> bool isa(U a) {
-  if (dynamic_cast<T *>(a))
-    return true;
-
-  return false;
+/// T must provide a static classof(const Base *), which checks the kind tag
+/// stored in the node instead of going through the C++ RTTI
+template <typename T, typename U> bool isa(U *a) {
+  return a && std::remove_cv_t<T>::classof(a);
 }
 
-template <typename T, typename U> T *dyncast(U a) {
-  if (T *casted = dynamic_cast<T *>(a))
-    return casted;
+template <typename T, typename U> T *dyncast(U *a) {
+  if (isa<T>(a))
+    return static_cast<T *>(a);
 
   return nullptr;
 }
@@ -2,9 +2,11 @@
 #include "core/type.h"
 #include "core/util.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <llvm/IR/Constant.h>
+#include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
 
 using namespace vcc;
@@ -15,10 +17,14 @@ static void printSpaceBasedOnDepth(int depth) {
   }
 }
 
-const FilePos &ASTBase::getPos() const { return m_locus; }
+SourceLocation ASTBase::getLocation() const { return m_locus; }
 
-Statement::Statement(const std::vector<ASTBase *> childrens, FilePos locus)
-    : ASTBase(std::vector<Statement *>(), locus) {
+code::TreeCode ASTBase::getCode() const { return m_code; }
+
+Statement::Statement(code::TreeCode code,
+                     const std::vector<ASTBase *> childrens,
+                     SourceLocation locus)
+    : ASTBase(code, std::vector<Statement *>(), locus) {
   for (ASTBase *child : childrens) {
     addChildren(child);
   }
@@ -37,8 +43,10 @@ void ASTBase::debugDump(int depth) {
   }
 }
 
-ASTBase::ASTBase(const std::vector<Expression *> childrens, FilePos locus)
-    : m_parent(nullptr), m_childrens(), m_locus(locus) {
+ASTBase::ASTBase(code::TreeCode code,
+                 const std::vector<Expression *> childrens,
+                 SourceLocation locus)
+    : m_code(code), m_locus(locus), m_parent(nullptr), m_childrens() {
 
   for (ASTBase *children : childrens) {
     addChildren(children);
@@ -46,8 +54,10 @@ ASTBase::ASTBase(const std::vector<Expression *> childrens, FilePos locus)
   }
 }
 
-ASTBase::ASTBase(const std::vector<Statement *> childrens, FilePos locus)
-    : m_parent(nullptr), m_childrens(), m_locus(locus) {
+ASTBase::ASTBase(code::TreeCode code,
+                 const std::vector<Statement *> childrens,
+                 SourceLocation locus)
+    : m_code(code), m_locus(locus), m_parent(nullptr), m_childrens() {
 
   for (ASTBase *children : childrens) {
     addChildren(children);
@@ -55,26 +65,30 @@ ASTBase::ASTBase(const std::vector<Statement *> childrens, FilePos locus)
   }
 }
 
-const std::set<ASTBase *> &ASTBase::getChildren() const { return m_childrens; }
+llvm::ArrayRef<ASTBase *> ASTBase::getChildren() const { return m_childrens; }
 
 void ASTBase::removeChildren(ASTBase *children) {
-  assert(m_childrens.find(children) != m_childrens.end() &&
-         "must contain element to begin with");
+  auto it = std::find(m_childrens.begin(), m_childrens.end(), children);
+  assert(it != m_childrens.end() && "must contain element to begin with");
 
-  // FIXME: we may have just leaked memory here!
-  children->setParent(nullptr);
-  m_childrens.erase(children);
+  children->m_parent = nullptr;
+  m_childrens.erase(it);
 }
 
 void ASTBase::addChildren(ASTBase *children) {
-  m_childrens.insert(children);
+  // a node is in the children of its parent exactly once, at the position it
+  // was first added
+  if (children->m_parent == this)
+    return;
+  // a node has one parent, it leaves the children of the previous one
+  if (children->m_parent)
+    children->m_parent->removeChildren(children);
+
+  m_childrens.push_back(children);
   children->m_parent = this;
 }
 
-void ASTBase::setParent(ASTBase *parent) {
-  m_parent = parent;
-  m_parent->m_childrens.insert(this);
-}
+void ASTBase::setParent(ASTBase *parent) { parent->addChildren(this); }
 
 void AssignmentStatement::dump() {}
 
@@ -82,14 +96,27 @@ const ASTBase *ASTBase::getParent() const { return m_parent; }
 
 void ASTBase::dump() { return; }
 
-const std::string &FunctionDecl::getName() const { return m_name; }
+Symbol FunctionDecl::getName() const { return m_name; }
+
+bool FunctionDecl::isExtern() const { return m_is_extern; }
+
+bool FunctionDecl::isInvalid() const { return m_is_invalid; }
+
+void FunctionDecl::setInvalid() { m_is_invalid = true; }
+
+const std::vector<Statement *> &FunctionDecl::getStatements() const {
+  return m_statements;
+}
+
+FunctionArgLists *FunctionDecl::getArgList() { return m_arg_list; }
 
 llvm::Function *FunctionDecl::getLLVMFunction() const { return m_function; }
 
 FunctionDecl::FunctionDecl(std::vector<Statement *> &statements,
-                           FunctionArgLists *arg_list, std::string &&name,
-                           Type *ret, bool is_extern, FilePos locus)
-    : Statement({arg_list}, locus), m_statements(statements),
+                           FunctionArgLists *arg_list, Symbol name, Type *ret,
+                           bool is_extern, SourceLocation locus)
+    : Statement(code::FunctionDecl, {arg_list}, locus),
+      m_statements(statements),
       m_arg_list(arg_list), m_name(name), m_return_type(ret),
       m_is_extern(is_extern) {
   // making sure that arg_list is always the first in the syntax tree!
@@ -106,8 +133,9 @@ const FunctionArgLists::ArgsIter FunctionDecl::getArgsEnd() const {
   return m_arg_list->end();
 }
 
-FunctionArgLists::FunctionArgLists(std::vector<TypeInfo> &&args, FilePos locus)
-    : Statement({}, locus), m_args(args) {}
+FunctionArgLists::FunctionArgLists(std::vector<TypeInfo> &&args,
+                                   SourceLocation locus)
+    : Statement(code::FunctionArgLists, {}, locus), m_args(args) {}
 
 FunctionArgLists::ArgsIter FunctionArgLists::begin() const {
   return m_args.cbegin();
@@ -117,10 +145,17 @@ FunctionArgLists::ArgsIter FunctionArgLists::end() const {
   return m_args.cend();
 }
 
+std::vector<TypeInfo> &FunctionArgLists::getArgs() { return m_args; }
+
 AssignmentStatement::AssignmentStatement(Expression *ref_expr,
-                                         Expression *expression, FilePos locus)
-    : Statement({ref_expr, expression}, locus), m_ref_expr(ref_expr),
-      m_expression(expression) {}
+                                         Expression *expression,
+                                         SourceLocation locus)
+    : Statement(code::AssignmentStatement, {ref_expr, expression}, locus),
+      m_ref_expr(ref_expr), m_expression(expression) {}
+
+Expression *AssignmentStatement::getRefExpression() { return m_ref_expr; }
+
+Expression *AssignmentStatement::getExpression() { return m_expression; }
 
 void FunctionDecl::dump() {
   std::cout << "name: " << m_name << " args: extern: " << m_is_extern;
@@ -129,24 +164,33 @@ void FunctionDecl::dump() {
   }
 }
 
-ReturnStatement::ReturnStatement(Expression *expression, FilePos locus)
-    : Statement({}, locus), m_expression(expression) {
+ReturnStatement::ReturnStatement(Expression *expression, SourceLocation locus)
+    : Statement(code::ReturnStatement, {}, locus), m_expression(expression) {
   // it is possible that expression is null
   if (expression)
     addChildren(expression);
 }
 
-IdentifierExpr::IdentifierExpr(const std::string &name, FilePos locus)
-    : LocatorExpression({}, locus), m_name(name) {}
+Expression *ReturnStatement::getExpression() { return m_expression; }
+
+IdentifierExpr::IdentifierExpr(Symbol name, SourceLocation locus)
+    : LocatorExpression(code::IdentifierExpr, {}, locus), m_name(name) {}
+
+Symbol IdentifierExpr::getName() const { return m_name; }
 
-ConstantExpr::ConstantExpr(int value, FilePos locus)
-    : Expression({}, locus), m_value(value) {}
+TypeInfo *IdentifierExpr::getVariable() const { return m_variable; }
+
+void IdentifierExpr::setVariable(TypeInfo *variable) { m_variable = variable; }
+
+ConstantExpr::ConstantExpr(int value, SourceLocation locus)
+    : Expression(code::ConstantExpr, {}, locus), m_value(value) {}
 
 int ConstantExpr::getValue() { return m_value; }
 
 BinaryExpression::BinaryExpression(Expression *lhs, BinaryExpressionType type,
-                                   FilePos locus)
-    : Expression({lhs}, locus), m_lhs(lhs), m_rhs(nullptr), m_kind(type) {}
+                                   SourceLocation locus)
+    : Expression(code::BinaryExpression, {lhs}, locus), m_lhs(lhs),
+      m_rhs(nullptr), m_kind(type) {}
 
 BinaryExpression::BinaryExpressionType
 BinaryExpression::getFromLexType(lex::Token token) {
@@ -184,6 +228,34 @@ void BinaryExpression::setRHS(Expression *rhs) {
   m_rhs = rhs;
 }
 
+Expression *BinaryExpression::getLHS() { return m_lhs; }
+
+Expression *BinaryExpression::getRHS() { return m_rhs; }
+
+BinaryExpression::BinaryExpressionType BinaryExpression::getKind() const {
+  return m_kind;
+}
+
+bool BinaryExpression::isComparison() const {
+  switch (m_kind) {
+  case Equal:
+  case NEquals:
+  case GE:
+  case GT:
+  case LE:
+  case LT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+Expression *BinaryExpression::getSimplified() const { return m_simplified; }
+
+void BinaryExpression::setSimplified(Expression *operand) {
+  m_simplified = operand;
+}
+
 void BinaryExpression::dump() {
   switch (m_kind) {
   case Add:
@@ -228,23 +300,37 @@ bool ASTBase::doesDefineScope(code::TreeCode code) {
 const FunctionDecl *ASTBase::getFirstFunctionDecl() const {
   for (const ASTBase *current = this; current; current = current->getParent()) {
     const FunctionDecl *decl = nullptr;
-    if ((decl = dynamic_cast<const FunctionDecl *>(current)))
+    if ((decl = dyncast<const FunctionDecl>(current)))
       return decl;
   }
 
   return nullptr;
 }
 
-CallExpr::CallExpr(const std::string &name,
-                   const std::vector<Expression *> &expression, FilePos locus)
-    : Expression(expression, locus), m_func_name(name),
+CallExpr::CallExpr(Symbol name, const std::vector<Expression *> &expression,
+                   SourceLocation locus)
+    : Expression(code::CallExpr, expression, locus), m_func_name(name),
       m_expressions(expression) {}
 
 void CallExpr::dump() { std::cout << "name: " << m_func_name; }
 
+Symbol CallExpr::getName() const { return m_func_name; }
+
+const std::vector<Expression *> &CallExpr::getArguments() const {
+  return m_expressions;
+}
+
+FunctionDecl *CallExpr::getFunctionDecl() const { return m_function_decl; }
+
+void CallExpr::setFunctionDecl(FunctionDecl *function_decl) {
+  m_function_decl = function_decl;
+}
+
 IfStatement::IfStatement(Expression *cond,
-                         std::vector<Statement *> &&expressions, FilePos locus)
-    : Statement({cond}, locus), m_cond(cond), m_statements(expressions) {
+                         std::vector<Statement *> &&expressions,
+                         SourceLocation locus)
+    : Statement(code::IfStatement, {cond}, locus), m_cond(cond),
+      m_statements(expressions) {
   for (ASTBase *expression : expressions) {
     addChildren(expression);
   }
@@ -252,26 +338,37 @@ IfStatement::IfStatement(Expression *cond,
 
 void IfStatement::dump() {}
 
-DeclarationStatement::DeclarationStatement(const std::string &name,
-                                           Expression *base, Type *type,
-                                           FilePos locus)
-    : Statement({}, locus), m_expression(base), m_name(name), m_type(type) {
+Expression *IfStatement::getCondition() { return m_cond; }
+
+const std::vector<Statement *> &IfStatement::getStatements() const {
+  return m_statements;
+}
+
+DeclarationStatement::DeclarationStatement(Symbol name, Expression *base,
+                                           Type *type, SourceLocation locus)
+    : Statement(code::DeclarationStatement, {}, locus), m_expression(base),
+      m_variable{type, name} {
   // it is possible that the child is a nullptr, meaning we only have to
   // allocate space
   if (base)
     addChildren(base);
 }
 
-const std::string &DeclarationStatement::getName() { return m_name; }
+Symbol DeclarationStatement::getName() { return m_variable.name; }
+
+Type *DeclarationStatement::getType() { return m_variable.type; }
 
-Type *DeclarationStatement::getType() { return m_type; }
+TypeInfo *DeclarationStatement::getVariable() { return &m_variable; }
 
-void DeclarationStatement::dump() { std::cout << "name: " << m_name; }
+void DeclarationStatement::dump() {
+  std::cout << "name: " << m_variable.name;
+}
 
 WhileStatement::WhileStatement(Expression *cond,
                                std::vector<Statement *> &&expression,
-                               FilePos locus)
-    : Statement({cond}, locus), m_cond(cond), m_statements(expression) {
+                               SourceLocation locus)
+    : Statement(code::WhileStatement, {cond}, locus), m_cond(cond),
+      m_statements(expression) {
   for (ASTBase *base : m_statements) {
     addChildren(base);
   }
@@ -279,15 +376,23 @@ WhileStatement::WhileStatement(Expression *cond,
 
 void WhileStatement::dump() { return; }
 
-MemberAccessExpression::MemberAccessExpression(const std::string &name,
-                                               const std::string &member,
-                                               FilePos locus)
-    : m_base_name(name), m_member(member), LocatorExpression({}, locus) {}
+Expression *WhileStatement::getCondition() { return m_cond; }
+
+const std::vector<Statement *> &WhileStatement::getStatements() const {
+  return m_statements;
+}
+
+MemberAccessExpression::MemberAccessExpression(Symbol name, Symbol member,
+                                               SourceLocation locus)
+    : m_base_name(name), m_member(member),
+      LocatorExpression(code::MemberAccessExpression, {}, locus) {}
 
 MemberAccessExpression::MemberAccessExpression(LocatorExpression *parent,
-                                               const std::string &member,
-                                               FilePos locus)
-    : m_member(member), LocatorExpression({}, locus), m_parent(parent) {
+                                               Symbol member,
+                                               SourceLocation locus)
+    : m_member(member),
+      LocatorExpression(code::MemberAccessExpression, {}, locus),
+      m_parent(parent) {
   parent->addChildren(this);
 }
 
@@ -300,49 +405,68 @@ void MemberAccessExpression::dump() {
             << " this: " << this;
 }
 
-ArrayAccessExpression::ArrayAccessExpression(const std::string &name,
+ArrayAccessExpression::ArrayAccessExpression(Symbol name,
                                              Expression *expression,
-                                             FilePos locus)
-    : LocatorExpression({expression}, locus), m_index_expression(expression),
-      m_base_name(name) {}
+                                             SourceLocation locus)
+    : LocatorExpression(code::ArrayAccessExpression, {expression}, locus),
+      m_index_expression(expression), m_base_name(name) {}
 
 ArrayAccessExpression::ArrayAccessExpression(LocatorExpression *parent,
                                              Expression *index_expression,
-                                             FilePos locus)
-    : LocatorExpression({index_expression}, locus),
+                                             SourceLocation locus)
+    : LocatorExpression(code::ArrayAccessExpression, {index_expression}, locus),
       m_index_expression(index_expression), m_parent_expression(parent) {
   parent->addChildren(this);
 }
 
+LocatorExpression *MemberAccessExpression::getParentExpression() {
+  return m_parent;
+}
+
+LocatorExpression *MemberAccessExpression::getChildPosfixExpression() {
+  return m_child_posfix_expression;
+}
+
+Symbol MemberAccessExpression::getBaseName() const { return m_base_name; }
+
+Symbol MemberAccessExpression::getMember() const { return m_member; }
+
+TypeInfo *MemberAccessExpression::getVariable() const { return m_variable; }
+
+void MemberAccessExpression::setVariable(TypeInfo *variable) {
+  m_variable = variable;
+}
+
 void ArrayAccessExpression::dump() {
   std::cout << "[]"
             << " child*: " << m_child_posfix_expression << " this: " << this;
 }
 
-LocatorExpression::LocatorExpression(const std::vector<Expression *> &childrens,
-                                     FilePos locus)
-    : Expression(childrens, locus) {}
-
-Type *ArrayAccessExpression::getGEPChildType(ContextHolder holder) {
-  Type *current_type = getGEPType(holder);
-  assert((current_type->isArray() || current_type->isPointer()) &&
-         "array access expression must have valid type!");
+LocatorExpression *ArrayAccessExpression::getParentExpression() {
+  return m_parent_expression;
+}
 
-  if (PointerType *type = dyncast<PointerType>(current_type)) {
-    return type->getPointee();
-  }
+LocatorExpression *ArrayAccessExpression::getChildPosfixExpression() {
+  return m_child_posfix_expression;
+}
 
-  return current_type->getAs<ArrayType>()->getBase();
+Expression *ArrayAccessExpression::getIndexExpression() {
+  return m_index_expression;
 }
 
-Type *MemberAccessExpression::getGEPChildType(ContextHolder holder) {
-  return getGEPType(holder)
-      ->getAs<StructType>()
-      ->getElement(m_member)
-      .value()
-      .type;
+Symbol ArrayAccessExpression::getBaseName() const { return m_base_name; }
+
+TypeInfo *ArrayAccessExpression::getVariable() const { return m_variable; }
+
+void ArrayAccessExpression::setVariable(TypeInfo *variable) {
+  m_variable = variable;
 }
 
+LocatorExpression::LocatorExpression(code::TreeCode code,
+                                     const std::vector<Expression *> &childrens,
+                                     SourceLocation locus)
+    : Expression(code, childrens, locus) {}
+
 void DeRefExpression::setPosfixChildExpression(LocatorExpression *expression) {
   m_posfix_child = expression;
 }
@@ -380,7 +504,7 @@ llvm::Value *LocatorExpression::getRef(ContextHolder holder) {
 }
 
 llvm::Value *IdentifierExpr::getRef(ContextHolder holder) {
-  return holder->symbol_table.lookupLocalVariable(this, m_name).value;
+  return m_variable->address;
 }
 
 static llvm::Value *getStartOfPointerFromParent(Expression *expression,
@@ -398,14 +522,13 @@ static llvm::Value *getStartOfPointerFromParent(Expression *expression,
 
 llvm::Value *MemberAccessExpression::getCurrentRef(ContextHolder holder) {
   llvm::Value *start_of_pointer =
-      (m_parent == nullptr)
-          ? holder->symbol_table.lookupLocalVariable(this, m_base_name).value
-          : getStartOfPointerFromParent(m_parent, holder);
+      (m_parent == nullptr) ? m_variable->address
+                            : getStartOfPointerFromParent(m_parent, holder);
 
   // getting the actual field number
-  Type *current_type = getGEPType(holder);
+  Type *current_type = getGEPType();
   int field_num =
-      current_type->getAs<StructType>()->getElement(m_member)->field_num;
+      current_type->getAs<StructType>()->getElement(m_member).field_num;
   llvm::Value *zero =
       llvm::ConstantInt::get(llvm::Type::getInt32Ty(holder->context), 0);
   llvm::Value *offset = llvm::ConstantInt::get(
@@ -421,11 +544,11 @@ llvm::Value *ArrayAccessExpression::getCurrentRef(ContextHolder holder) {
   // are at the most top level! Or else we get the location from parent's getRef
   llvm::Value *start_of_pointer =
       (m_parent_expression == nullptr)
-          ? holder->symbol_table.lookupLocalVariable(this, m_base_name).value
+          ? m_variable->address
           : getStartOfPointerFromParent(m_parent_expression, holder);
 
-  Type *type = getGEPType(holder);
-  llvm::Type *llvm_type = getGEPType(holder)->getType(holder);
+  Type *type = getGEPType();
+  llvm::Type *llvm_type = type->getType(holder);
   // we cannot just do type->isPointer because the last layer
   // returns a builtin usually say i32**
   if (!type->isArray())
@@ -445,19 +568,31 @@ llvm::Value *ArrayAccessExpression::getCurrentRef(ContextHolder holder) {
 
 Type *FunctionDecl::getReturnType() const { return m_return_type; }
 
-Expression::Expression(const std::vector<Expression *> children, FilePos locus)
-    : ASTBase(children, locus) {}
+Expression::Expression(code::TreeCode code,
+                       const std::vector<Expression *> children,
+                       SourceLocation locus)
+    : ASTBase(code, children, locus) {}
 
-DeRefExpression::DeRefExpression(Expression *ref_get, FilePos locus)
-    : LocatorExpression({ref_get}, locus), m_ref(ref_get) {}
+DeRefExpression::DeRefExpression(Expression *ref_get, SourceLocation locus)
+    : LocatorExpression(code::DeRefExpression, {ref_get}, locus),
+      m_ref(ref_get) {}
 
 void DeRefExpression::dump() {}
 
-RefExpression::RefExpression(Expression *inner, FilePos locus)
-    : LocatorExpression({inner}, locus), m_inner_expression(inner) {}
+Expression *DeRefExpression::getPointerExpression() { return m_ref; }
+
+LocatorExpression *DeRefExpression::getPosfixChildExpression() {
+  return m_posfix_child;
+}
+
+RefExpression::RefExpression(Expression *inner, SourceLocation locus)
+    : LocatorExpression(code::RefExpression, {inner}, locus),
+      m_inner_expression(inner) {}
 
 void RefExpression::dump() {}
 
+Expression *RefExpression::getInnerExpression() { return m_inner_expression; }
+
 llvm::FunctionType *FunctionDecl::getFunctionType(ContextHolder holder) const {
   std::vector<llvm::Type *> args;
   for (auto it = m_arg_list->begin(), ie = m_arg_list->end(); it != ie; ++it) {
@@ -469,24 +604,39 @@ llvm::FunctionType *FunctionDecl::getFunctionType(ContextHolder holder) const {
   return function_type;
 }
 
-CallStatement::CallStatement(Expression *call_expression, FilePos locus)
-    : Statement({call_expression}, locus), m_call_expr(call_expression) {}
+CallStatement::CallStatement(Expression *call_expression, SourceLocation locus)
+    : Statement(code::CallStatement, {call_expression}, locus),
+      m_call_expr(call_expression) {}
 
-StringLiteral::StringLiteral(std::string string, FilePos locus)
-    : Expression({}, locus), m_string_literal(string) {}
+Expression *CallStatement::getCallExpression() { return m_call_expr; }
+
+StringLiteral::StringLiteral(std::string string, SourceLocation locus)
+    : Expression(code::StringLiteral, {}, locus), m_string_literal(string) {}
 
 void StringLiteral::dump() {}
 
 CastExpression::CastExpression(Expression *cast_expression, Type *casted_to,
-                               FilePos loc)
-    : Expression({cast_expression}, loc), m_cast_to(casted_to),
-      m_to_be_casted_expression(cast_expression) {}
+                               SourceLocation loc)
+    : Expression(code::CastExpression, {cast_expression}, loc),
+      m_cast_to(casted_to), m_to_be_casted_expression(cast_expression) {}
+
+Expression *CastExpression::getExpression() {
+  return m_to_be_casted_expression;
+}
+
+Type *CastExpression::getCastTo() { return m_cast_to; }
+
+bool CastExpression::canCast(Type *from, Type *to) {
+  if (Type::isSame(from, to))
+    return true;
 
-void CastExpression::emitErrorAndExit(ContextHolder holder) {
-  // we cannot perform a cast emit a diagnostics message
-  holder->diagnostics.diag(this, holder->getLine(getPos()),
-                           "cannot perform a cast");
-  std::exit(-1);
+  // any builtin converts to any other, see builtinCast
+  if (from->isBuiltin() && to->isBuiltin())
+    return true;
+
+  // this is okay since opaque pointer is already assumed in every pointer type
+  return (from->isPointer() && to->isVoidPtr()) ||
+         (from->isVoidPtr() && to->isPointer());
 }
 
 static std::vector<DeclarationStatement *>
@@ -506,8 +656,7 @@ getDeclarationStatementImpl(const std::vector<Statement *> &statement) {
         break;
       }
       default:
-        std::cerr << "you have missed a case" << std::endl;
-        std::exit(-1);
+        assert(false && "you have missed a case");
       }
     }
     if (s->getCode() == code::DeclarationStatement)
@@ -532,210 +681,66 @@ Expression *DeclarationStatement::getExpression() { return m_expression; }
 // ================================================================================
 // ====================== Expression Implementation::getType
 // ======================
-Type *CastExpression::getType(ContextHolder holder) { return m_cast_to; }
+Type *Expression::getType() const { return m_type; }
 
-Type *StringLiteral::getType(ContextHolder holder) {
-  return new PointerType(new BuiltinType(BuiltinType::Char));
-}
+void Expression::setType(Type *type) { m_type = type; }
 
-Type *RefExpression::getType(ContextHolder holder) {
-  // FIXME: we can probably prevent a heap allocation every time
-  return new PointerType(m_inner_expression->getType(holder));
-}
+const ConstantValue *Expression::getConstant() const { return m_constant; }
 
-Type *MemberAccessExpression::getGEPType(ContextHolder holder) {
-  if (!m_parent)
-    return holder->symbol_table.lookupLocalVariable(this, m_base_name).type;
-
-  // FIXME: this shares a lot same code with ArrayAccessExpression::getType,
-  // maybe we should have a standard interface that solves this entirely?
-  if (ArrayAccessExpression *parent =
-          dyncast<ArrayAccessExpression>(m_parent)) {
-    return parent->getGEPChildType(holder);
-  }
-
-  if (DeRefExpression *expression = dyncast<DeRefExpression>(m_parent)) {
-    return expression->getInnerType(holder);
-  }
-
-  assert(isa<MemberAccessExpression>(m_parent));
-  MemberAccessExpression *parent = dyncast<MemberAccessExpression>(m_parent);
-  return parent->getGEPChildType(holder);
+void Expression::setConstant(const ConstantValue *constant) {
+  m_constant = constant;
 }
 
-Type *MemberAccessExpression::getType(ContextHolder holder) {
-  if (m_child_posfix_expression)
-    return m_child_posfix_expression->getType(holder);
+ConstantValue::ConstantValue(llvm::APInt integer)
+    : m_is_float(false), m_integer(std::move(integer)), m_float(0.0f) {}
 
-  // we don't have a child
-  return getGEPType(holder)->getAs<StructType>()->getElement(m_member)->type;
-}
+ConstantValue::ConstantValue(llvm::APFloat floating)
+    : m_is_float(true), m_float(std::move(floating)) {}
 
-Type *DeRefExpression::getType(ContextHolder holder) {
-  if (m_posfix_child)
-    return m_posfix_child->getType(holder);
-
-  return dyncast<Expression>(m_ref)
-      ->getType(holder)
-      ->getAs<PointerType>()
-      ->getPointee();
-}
+bool ConstantValue::isFloat() const { return m_is_float; }
 
-Type *DeRefExpression::getInnerType(ContextHolder holder) {
-  return dyncast<Expression>(m_ref)
-      ->getType(holder)
-      ->getAs<PointerType>()
-      ->getPointee();
+const llvm::APInt &ConstantValue::getInteger() const {
+  assert(!m_is_float);
+  return m_integer;
 }
 
-Type *ArrayAccessExpression::getType(ContextHolder holder) {
-  if (m_child_posfix_expression)
-    return m_child_posfix_expression->getType(holder);
-
-  if (getGEPType(holder)->isBuiltin()) {
-    return getGEPType(holder);
-  }
-  return getGEPChildType(holder);
+const llvm::APFloat &ConstantValue::getFloat() const {
+  assert(m_is_float);
+  return m_float;
 }
 
-Type *ConstantExpr::getType(ContextHolder holder) {
-  return new BuiltinType(BuiltinType::Int);
+llvm::Constant *ConstantValue::emit(ContextHolder holder) const {
+  // the width of the value picks the llvm type
+  if (m_is_float)
+    return llvm::ConstantFP::get(holder->context, m_float);
+  return llvm::ConstantInt::get(holder->context, m_integer);
 }
 
-Type *IdentifierExpr::getType(ContextHolder holder) {
-  return holder->symbol_table.lookupLocalVariable(this, m_name).type;
-}
+Type *MemberAccessExpression::getGEPType() const { return m_gep_type; }
 
-Type *CallExpr::getType(ContextHolder holder) {
-  return holder->symbol_table.lookupFunction(m_func_name)->getReturnType();
-}
+void MemberAccessExpression::setGEPType(Type *type) { m_gep_type = type; }
 
-static Type *getIntWithMoreBits(BuiltinType *lhs, BuiltinType *rhs) {
-  assert(lhs->isIntegerKind() && rhs->isIntegerKind());
-  return lhs->getBitSize() > rhs->getBitSize() ? lhs : rhs;
+Type *MemberAccessExpression::getGEPChildType() const {
+  return m_gep_type->getAs<StructType>()->getElement(m_member).type;
 }
 
-Type *BinaryExpression::getType(ContextHolder holder) {
-  // check for boolean expression
-  switch (m_kind) {
-  // if it is from a boolean expression, it should always return a boolean
-  // expression regardless of the two types
-  case Equal:
-  case NEquals:
-  case GE:
-  case GT:
-  case LE:
-  case LT:
-    return new BuiltinType(BuiltinType::Bool);
-  default:
-    break;
-  };
-
-  if (m_lhs->getType(holder)->isPointer() ||
-      m_rhs->getType(holder)->isPointer()) {
-    assert(false && "please emit error here. pointer type in binary expression "
-                    "is illform for now!");
-    return nullptr;
-  }
-
-  if (m_lhs->getType(holder)->isBuiltin() &&
-      m_rhs->getType(holder)->isBuiltin()) {
-    BuiltinType *casted_lhs = m_lhs->getType(holder)->getAs<BuiltinType>();
-    BuiltinType *casted_rhs = m_rhs->getType(holder)->getAs<BuiltinType>();
-
-    // return float type if either the left hand side or the right hand side
-    // have a floating point
-    if (casted_lhs->isFloat())
-      return casted_lhs;
-    else if (casted_rhs->isFloat())
-      return casted_rhs;
-
-    return getIntWithMoreBits(casted_lhs, casted_rhs);
-  }
-
-  assert(false && "don't know what to do here!");
-  return nullptr;
+Type *DeRefExpression::getInnerType() const {
+  return m_ref->getType()->getAs<PointerType>()->getPointee();
 }
 
-// FIXME: this really should be callled getGEP type and not getType
-// getType returns the result of the ast expression, but currently, this returns
-// the GEP type
-Type *ArrayAccessExpression::getGEPType(ContextHolder holder) {
-  if (!m_parent_expression) {
-    Type *type =
-        holder->symbol_table.lookupLocalVariable(this, m_base_name).type;
-    if (type->isArray())
-      return type->getAs<ArrayType>();
-
-    return type->getAs<PointerType>()->getPointee();
-  }
-
-  // trying to get type from parent expression!
-  if (ArrayAccessExpression *parent =
-          dyncast<ArrayAccessExpression>(m_parent_expression)) {
-    return parent->getGEPChildType(holder);
-  }
+Type *ArrayAccessExpression::getGEPType() const { return m_gep_type; }
 
-  assert(isa<MemberAccessExpression>(m_parent_expression) &&
-         "must be member expresion beacuse we have no options left!");
-  MemberAccessExpression *parent =
-      dyncast<MemberAccessExpression>(m_parent_expression);
-  return parent->getGEPChildType(holder);
-}
-
-// ==========================================
-// TreeCode Implementation
-//
-code::TreeCode FunctionArgLists::getCode() const {
-  return code::FunctionArgLists;
-}
+void ArrayAccessExpression::setGEPType(Type *type) { m_gep_type = type; }
 
-code::TreeCode CallStatement::getCode() const { return code::CallStatement; }
+Type *ArrayAccessExpression::getGEPChildType() const {
+  if (ArrayType *type = dyncast<ArrayType>(m_gep_type))
+    return type->getBase();
 
-code::TreeCode FunctionDecl::getCode() const { return code::FunctionDecl; }
-
-code::TreeCode AssignmentStatement::getCode() const {
-  return code::AssignmentStatement;
-}
-
-code::TreeCode ReturnStatement::getCode() const {
-  return code::ReturnStatement;
-}
-
-code::TreeCode IfStatement::getCode() const { return code::IfStatement; }
-
-code::TreeCode WhileStatement::getCode() const { return code::WhileStatement; }
-
-code::TreeCode ConstantExpr::getCode() const { return code::ConstantExpr; }
-
-code::TreeCode CallExpr::getCode() const { return code::CallExpr; }
-
-code::TreeCode BinaryExpression::getCode() const {
-  return code::BinaryExpression;
-}
-
-code::TreeCode CastExpression::getCode() const { return code::CastExpression; }
-
-code::TreeCode IdentifierExpr::getCode() const { return code::IdentifierExpr; }
-
-code::TreeCode MemberAccessExpression::getCode() const {
-  return code::MemberAccessExpression;
-}
-
-code::TreeCode ArrayAccessExpression::getCode() const {
-  return code::ArrayAccessExpression;
-}
-
-code::TreeCode DeRefExpression::getCode() const {
-  return code::DeRefExpression;
-}
-
-code::TreeCode RefExpression::getCode() const { return code::RefExpression; }
-
-code::TreeCode StringLiteral::getCode() const { return code::StringLiteral; }
+  if (PointerType *type = dyncast<PointerType>(m_gep_type))
+    return type->getPointee();
 
-code::TreeCode DeclarationStatement::getCode() const {
-  return code::DeclarationStatement;
+  // indexing through a pointer, the GEP type is the pointee already
+  return m_gep_type;
 }
 
 // ======================================================
@@ -836,6 +841,11 @@ llvm::Value *BinaryExpression::handleInteger(ContextHolder holder,
 }
 
 llvm::Value *BinaryExpression::getVal(ContextHolder holder) {
+  if (const ConstantValue *constant = getConstant())
+    return constant->emit(holder);
+  if (m_simplified)
+    return m_simplified->getVal(holder);
+
   llvm::Value *right_hand_side = m_rhs->getVal(holder);
   llvm::Value *left_hand_side = m_lhs->getVal(holder);
 
@@ -926,30 +936,25 @@ llvm::Value *BinaryExpression::getVal(ContextHolder holder) {
 }
 
 llvm::Value *IdentifierExpr::getVal(ContextHolder holder) {
-  llvm::Value *loc_value =
-      holder->symbol_table.lookupLocalVariable(this, m_name).value;
-
-  llvm::Value *value =
-      holder->builder.CreateLoad(getType(holder)->getType(holder), loc_value);
+  llvm::Value *value = holder->builder.CreateLoad(
+      getType()->getType(holder), m_variable->address);
   return value;
 }
 
 void FunctionArgLists::codegen(ContextHolder holder) {
   const FunctionDecl *func = getFirstFunctionDecl();
 
-  // appending to symbol table
+  // every argument lives on the stack, where its uses find it
   int count = 0;
   llvm::Function *llvm_function = func->getLLVMFunction();
   for (llvm::Argument &arg : llvm_function->args()) {
-    const std::string &name = m_args[count].name;
-    arg.setName(name);
+    arg.setName(m_args[count].name.str());
 
     // allocating one integer
     llvm::Value *alloc_loc = holder->builder.CreateAlloca(arg.getType());
     holder->builder.CreateStore(&arg, alloc_loc);
 
-    holder->symbol_table.addLocalVariable(this, name, m_args[count].type,
-                                          alloc_loc);
+    m_args[count].address = alloc_loc;
     ++count;
   }
 }
@@ -960,13 +965,6 @@ void AssignmentStatement::codegen(ContextHolder holder) {
   llvm::Value *alloc_loc =
       dyncast<LocatorExpression>(m_ref_expr)->getRef(holder);
 
-  if (!Type::isSame(m_expression->getType(holder),
-                    m_ref_expr->getType(holder))) {
-    holder->diagnostics.diag(this, holder->getLine(getPos()), "invalid type");
-    std::exit(-1);
-    return;
-  }
-
   assert(expression_val && alloc_loc);
   holder->builder.CreateStore(expression_val, alloc_loc);
 }
@@ -986,9 +984,9 @@ void ReturnStatement::codegen(ContextHolder holder) {
 
 void FunctionDecl::buildExternalDecl(ContextHolder holder) {
   llvm::FunctionType *function_type = getFunctionType(holder);
-  holder->symbol_table.addFunction(this);
   m_function = llvm::Function::Create(
-      function_type, llvm::Function::ExternalLinkage, m_name, holder->module);
+      function_type, llvm::Function::ExternalLinkage, m_name.str(),
+      holder->module);
 }
 
 void CallStatement::codegen(ContextHolder holder) {
@@ -1025,12 +1023,11 @@ void FunctionDecl::emitAllocs(ContextHolder holder) {
     }
   }
 
-  // allocating the space and inserting into trie tree
+  // allocating the space, the uses of the variables find it there
   for (DeclarationStatement *statement : declaration_statements) {
     llvm::Type *llvm_type = statement->getType()->getType(holder);
-    llvm::Value *loc = holder->builder.CreateAlloca(llvm_type);
-    holder->symbol_table.addLocalVariable(statement, statement->getName(),
-                                          statement->getType(), loc);
+    statement->getVariable()->address =
+        holder->builder.CreateAlloca(llvm_type);
   }
 }
 
@@ -1041,12 +1038,10 @@ void FunctionDecl::codegen(ContextHolder holder) {
   llvm::FunctionType *function_type = getFunctionType(holder);
 
   m_function = llvm::Function::Create(
-      function_type, llvm::Function::ExternalLinkage, m_name, holder->module);
+      function_type, llvm::Function::ExternalLinkage, m_name.str(),
+      holder->module);
   m_function->setDSOLocal(true);
 
-  // add this to symbol table
-  holder->symbol_table.addFunction(this);
-
   // generating code for something
   llvm::BasicBlock *block =
       llvm::BasicBlock::Create(holder->context, "", m_function);
@@ -1062,33 +1057,13 @@ void FunctionDecl::codegen(ContextHolder holder) {
 }
 
 llvm::Value *CallExpr::getVal(ContextHolder holder) {
-  const FunctionDecl *function_decl =
-      holder->symbol_table.lookupFunction(m_func_name);
-
-  assert(function_decl && "this must exist for codegen!");
-  assert(function_decl->getFunctionType(holder)->getNumParams() ==
-             m_expressions.size() &&
-         "expected the same number of argument");
+  const FunctionDecl *function_decl = m_function_decl;
+  assert(function_decl && function_decl->getLLVMFunction() &&
+         "Sema only binds the functions defined before");
 
   std::vector<llvm::Value *> args;
-  int count = 0;
-  for (auto it = function_decl->getArgBegin(), ie = function_decl->getArgsEnd();
-       it != ie; ++it) {
-    if (!Type::isSame(it->type, m_expressions[count]->getType(holder))) {
-      holder->diagnostics.diag(this, holder->getLine(getPos()),
-                               "type mismatch");
-      std::exit(-1);
-    }
-
-    args.push_back(m_expressions[count]->getVal(holder));
-    ++count;
-  }
-
-  if (count != m_expressions.size()) {
-    holder->diagnostics.diag(this, holder->getLine(getPos()),
-                             "number of argument mismatch");
-    std::exit(-1);
-  }
+  for (Expression *expression : m_expressions)
+    args.push_back(expression->getVal(holder));
 
   llvm::Value *result =
       holder->builder.CreateCall(function_decl->getFunctionType(holder),
@@ -1118,24 +1093,17 @@ void IfStatement::codegen(ContextHolder holder) {
 
   assert(m_statements.size() >= 1 && "must be true for now");
   ASTBase *last_expression = m_statements[m_statements.size() - 1];
-  if (dynamic_cast<ReturnStatement *>(last_expression) == nullptr)
+  if (!isa<ReturnStatement>(last_expression))
     holder->builder.CreateBr(fallthrough_block);
 
   holder->builder.SetInsertPoint(fallthrough_block);
 }
 
 void DeclarationStatement::codegen(ContextHolder holder) {
-  llvm::Value *alloc_loc =
-      holder->symbol_table.lookupLocalVariable(this, m_name).value;
+  llvm::Value *alloc_loc = m_variable.address;
 
   // if we don't have an initializer, we don't allocate space
   if (m_expression) {
-    if (!Type::isSame(m_type, m_expression->getType(holder))) {
-      holder->diagnostics.diag(this, holder->getLine(getPos()),
-                               "type mismatch");
-      std::exit(-1);
-      return;
-    }
     llvm::Value *exp = m_expression->getVal(holder);
     llvm::Value *return_val = holder->builder.CreateStore(exp, alloc_loc);
   }
@@ -1179,10 +1147,7 @@ llvm::Value *MemberAccessExpression::getVal(ContextHolder holder) {
 
   // we are at the base case
   llvm::Value *ref_loc = getCurrentRef(holder);
-  llvm::Type *child_type = getGEPType(holder)
-                               ->getAs<StructType>()
-                               ->getElement(m_member)
-                               ->type->getType(holder);
+  llvm::Type *child_type = getGEPChildType()->getType(holder);
   return holder->builder.CreateLoad(child_type, ref_loc);
 }
 
@@ -1194,10 +1159,7 @@ llvm::Value *ArrayAccessExpression::getVal(ContextHolder holder) {
   // we are at the leaf
   // FIXME: is this even correct?
   llvm::Value *start_of_pointer = getCurrentRef(holder);
-  Type *current_type = getGEPType(holder);
-  Type *child_type =
-      current_type->isBuiltin() ? current_type : getGEPChildType(holder);
-  return holder->builder.CreateLoad(child_type->getType(holder),
+  return holder->builder.CreateLoad(getGEPChildType()->getType(holder),
                                     start_of_pointer);
 }
 
@@ -1206,17 +1168,14 @@ llvm::Value *DeRefExpression::getVal(ContextHolder holder) {
   if (m_posfix_child)
     return m_posfix_child->getVal(holder);
 
-  assert(m_ref->getType(holder)->isPointer());
   llvm::Value *current_value = m_ref->getVal(holder);
-  llvm::Type *base_type =
-      m_ref->getType(holder)->getAs<PointerType>()->getPointee()->getType(
-          holder);
+  llvm::Type *base_type = getInnerType()->getType(holder);
 
   return holder->builder.CreateLoad(base_type, current_value);
 }
 
 llvm::Value *DeRefExpression::getCurrentRef(ContextHolder holder) {
-  assert(m_ref->getType(holder)->isPointer());
+  assert(m_ref->getType()->isPointer());
   return m_ref->getVal(holder);
 }
 
@@ -1224,7 +1183,7 @@ llvm::Value *DeRefExpression::getRef(ContextHolder holder) {
   if (m_posfix_child)
     return m_posfix_child->getRef(holder);
 
-  assert(m_ref->getType(holder)->isPointer());
+  assert(m_ref->getType()->isPointer());
   return m_ref->getVal(holder);
 }
 
@@ -1273,7 +1232,10 @@ llvm::Value *CastExpression::builtinCast(BuiltinType *from, BuiltinType *to,
 }
 
 llvm::Value *CastExpression::getVal(ContextHolder holder) {
-  Type *from_type = m_to_be_casted_expression->getType(holder);
+  if (const ConstantValue *constant = getConstant())
+    return constant->emit(holder);
+
+  Type *from_type = m_to_be_casted_expression->getType();
   // we don't do anything if they are the same type
   if (Type::isSame(from_type, m_cast_to))
     return m_to_be_casted_expression->getVal(holder);
@@ -1288,6 +1250,6 @@ llvm::Value *CastExpression::getVal(ContextHolder holder) {
       (from_type->isVoidPtr() && m_cast_to->isPointer()))
     return m_to_be_casted_expression->getVal(holder);
 
-  emitErrorAndExit(holder);
+  assert(false && "Sema only lets through the casts above");
   return nullptr;
 }
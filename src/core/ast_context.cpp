@@ -0,0 +1,80 @@
+#include "core/ast_context.h"
+
+#include <cassert>
+#include <cstdint>
+
+using namespace vcc;
+
+/// the first address at or after at that is a multiple of alignment
+static char *alignUp(char *at, std::size_t alignment) {
+  std::uintptr_t address = reinterpret_cast<std::uintptr_t>(at);
+  return at + (alignment - address % alignment) % alignment;
+}
+
+ASTContext::~ASTContext() {
+  for (auto it = m_destructors.rbegin(); it != m_destructors.rend(); ++it)
+    it->destroy(it->object);
+}
+
+void *ASTContext::allocate(std::size_t size, std::size_t alignment) {
+  assert((alignment & (alignment - 1)) == 0 && "alignment is a power of 2");
+  m_allocated += size;
+
+  if (m_current) {
+    char *result = alignUp(m_current, alignment);
+    if (size <= std::size_t(m_end - result)) {
+      m_current = result + size;
+      return result;
+    }
+  }
+
+  // large objects get a slab of their own, so that the rest of the current
+  // slab is not wasted
+  if (size + alignment > SlabSize / 4)
+    return alignUp(allocateSlab(size + alignment), alignment);
+
+  m_current = allocateSlab(SlabSize);
+  m_end = m_current + SlabSize;
+  char *result = alignUp(m_current, alignment);
+  m_current = result + size;
+  return result;
+}
+
+char *ASTContext::allocateSlab(std::size_t size) {
+  // not value initialized, the objects initialize their own memory
+  m_slabs.emplace_back(new char[size]);
+  m_reserved += size;
+  return m_slabs.back().get();
+}
+
+void ASTContext::adopt(ASTContext &other) {
+  assert(&other != this && "cannot adopt itself");
+  for (std::unique_ptr<char[]> &slab : other.m_slabs)
+    m_slabs.push_back(std::move(slab));
+  m_destructors.insert(m_destructors.end(), other.m_destructors.begin(),
+                       other.m_destructors.end());
+  m_allocated += other.m_allocated;
+  m_reserved += other.m_reserved;
+
+  // what is left of the current slab of other is not reused
+  other.m_slabs.clear();
+  other.m_destructors.clear();
+  other.m_current = other.m_end = nullptr;
+  other.m_allocated = other.m_reserved = other.m_phase_start = 0;
+}
+
+std::size_t ASTContext::getBytesAllocated() const { return m_allocated; }
+
+std::size_t ASTContext::getBytesReserved() const { return m_reserved; }
+
+void ASTContext::endPhase(std::string name) {
+  m_phases.push_back({std::move(name), m_allocated - m_phase_start});
+  m_phase_start = m_allocated;
+}
+
+void ASTContext::printStats(std::ostream &os) const {
+  for (const Phase &phase : m_phases)
+    os << phase.name << ": " << phase.bytes << " bytes\n";
+  os << "total: " << m_allocated << " bytes allocated, " << m_reserved
+     << " bytes reserved in " << m_slabs.size() << " slabs\n";
+}
@@ -2,51 +2,123 @@
 #include "core/ast.h"
 #include "core/lex.h"
 #include "core/stream.h"
+#include "core/type.h"
+
+#include <cassert>
+#include <sstream>
 
 using namespace vcc;
 
-GlobalContext::GlobalContext(const char *path_to_file)
-    : context(), builder(context), module("my module", context), symbol_table(),
-      diagnostics(), stream(path_to_file) {}
+GlobalContext::GlobalContext(const char *path_to_file,
+                             FileStream::Backend backend,
+                             bool buffer_diagnostics)
+    : context(), builder(context), module("my module", context), sources(),
+      main_file(sources.addFile(path_to_file, backend)),
+      diagnostics(sources, buffer_diagnostics),
+      types(std::make_unique<TypeContext>()) {}
+
+GlobalContext::GlobalContext(std::string_view buffer, std::string name,
+                             bool buffer_diagnostics)
+    : context(), builder(context), module(name, context), sources(),
+      main_file(sources.addBuffer(buffer, name)),
+      diagnostics(sources, buffer_diagnostics),
+      types(std::make_unique<TypeContext>()) {}
+
+GlobalContext::~GlobalContext() = default;
+
+DiagnosticDriver::DiagnosticDriver(SourceManager &sources, bool buffered)
+    : m_sources(sources), m_buffered(buffered) {}
 
 void DiagnosticDriver::diag(const std::string &message) {
-  setError();
+  if (!countError())
+    return;
 
-  std::cerr << message << std::endl;
+  emit(message + "\n");
 }
 
 void DiagnosticDriver::diag(lex::Tokenizer &tokenizer,
                             const std::string &message) {
-  setError();
-  printFilePos(tokenizer.getPos(), message);
+  if (!countError())
+    return;
+  std::ostringstream os;
+  printFilePos(os, tokenizer.getName(), tokenizer.getPos(), message);
 
   std::string line = tokenizer.getLine(tokenizer.getPos());
-  std::cerr << line << "\n";
-  printSeeHere(tokenizer.getPos());
+  os << line << "\n";
+  printSeeHere(os, tokenizer.getPos());
+  emit(os.str());
 }
 
-void DiagnosticDriver::diag(const ASTBase *node,
-                            const std::string &line_in_file,
-                            const std::string &message) {
-  setError();
-  printFilePos(node->getPos(), message);
-  std::cerr << line_in_file << "\n";
-  printSeeHere(node->getPos());
+void DiagnosticDriver::diag(const ASTBase *node, const std::string &message) {
+  if (!countError())
+    return;
+
+  // only now is the location turned into a file, row and column
+  SourceLocation loc = node->getLocation();
+  FilePos pos = m_sources.getPos(loc);
+  std::ostringstream os;
+  printFilePos(os, m_sources.getName(loc), pos, message);
+  os << m_sources.getLine(loc) << "\n";
+  printSeeHere(os, pos);
+  emit(os.str());
+}
+
+void DiagnosticDriver::takeDiagnostics(DiagnosticDriver &other) {
+  assert(other.m_buffered && "only a buffered driver keeps its messages");
+  for (std::string &message : other.m_messages) {
+    if (countError())
+      emit(std::move(message));
+  }
+  other.m_messages.clear();
+}
+
+const std::vector<std::string> &DiagnosticDriver::getMessages() const {
+  return m_messages;
 }
 
-void DiagnosticDriver::setError() { m_error = true; }
+void DiagnosticDriver::emit(std::string message) {
+  if (m_buffered) {
+    m_messages.push_back(std::move(message));
+    return;
+  }
+
+  std::cerr << message << std::flush;
+}
+
+bool DiagnosticDriver::countError() {
+  ++m_error_count;
+  if (!m_error_limit || m_error_count <= m_error_limit)
+    return true;
+
+  // in line with the messages, so that it is buffered and comes after them
+  if (m_error_count == m_error_limit + 1)
+    emit("too many errors emitted, stopping now\n");
+  return false;
+}
 
-bool DiagnosticDriver::hasError() const { return m_error; }
+bool DiagnosticDriver::hasError() const { return m_error_count != 0; }
+
+unsigned DiagnosticDriver::getErrorCount() const { return m_error_count; }
+
+void DiagnosticDriver::setErrorLimit(unsigned limit) { m_error_limit = limit; }
+
+unsigned DiagnosticDriver::getErrorLimit() const { return m_error_limit; }
+
+bool DiagnosticDriver::reachedErrorLimit() const {
+  return m_error_limit && m_error_count > m_error_limit;
+}
 
-void DiagnosticDriver::printFilePos(const FilePos &pos,
+void DiagnosticDriver::printFilePos(std::ostream &os, const std::string &name,
+                                    const FilePos &pos,
                                     const std::string &message) {
-  std::cerr << pos.row << ":" << pos.col << " Error: " << message << "\n";
+  os << name << ":" << pos.row << ":" << pos.col << " Error: " << message
+     << "\n";
 }
 
-void DiagnosticDriver::printSeeHere(const FilePos &pos) {
+void DiagnosticDriver::printSeeHere(std::ostream &os, const FilePos &pos) {
   for (int i = 0; i < pos.col - 1; ++i) {
-    std::cerr << " ";
+    os << " ";
   }
 
-  std::cerr << "^---see here. \n" << std::endl;
+  os << "^---see here. \n\n";
 }
@@ -3,11 +3,99 @@
 #include "core/context.h"
 #include "core/parser.h"
 
-vcc::Parser vcc::parseFile(const char *path_to_file) {
-  // FIXME: move this into its own function!
-  ContextHolder context = std::make_shared<GlobalContext>(path_to_file);
-  Parser parser(context);
-  parser.start();
+#include <cassert>
+
+using namespace vcc;
 
+/// parses the stream of context, if it could be opened
+static Parser parseContext(ContextHolder context,
+                           const CompilerOptions &options) {
+  context->diagnostics.setErrorLimit(options.error_limit);
+  Parser parser(context, options.mode, options.thread_count,
+                options.entry_points);
+  if (!context->getMainStream().is_open()) {
+    context->diagnostics.diag("cannot open file: " +
+                              context->getMainStream().getName());
+    return parser;
+  }
+
+  parser.start();
   return parser;
 }
+
+CompilerInstance::CompilerInstance(CompilerOptions options)
+    : m_options(std::move(options)) {}
+
+CompilerInstance::~CompilerInstance() = default;
+
+bool CompilerInstance::compileFile(const char *path_to_file) {
+  return compile(std::make_shared<GlobalContext>(
+      path_to_file, m_options.backend, m_options.buffer_diagnostics));
+}
+
+bool CompilerInstance::compileBuffer(std::string_view buffer,
+                                     std::string name) {
+  return compile(std::make_shared<GlobalContext>(
+      buffer, std::move(name), m_options.buffer_diagnostics));
+}
+
+bool CompilerInstance::compile(ContextHolder context) {
+  assert(!m_context && "an instance compiles a single source");
+  m_context = context;
+  if (!m_options.data_layout.empty())
+    context->module.setDataLayout(m_options.data_layout);
+  m_parser = std::make_unique<Parser>(parseContext(context, m_options));
+
+  // every syntax and type error was reported by the parser and Sema, code
+  // generation only lowers a tree that is whole and well typed
+  if (haveError())
+    return false;
+
+  for (Statement *statement : m_parser->getSyntaxTree())
+    statement->codegen(context);
+  context->ast.endPhase("codegen");
+  return !haveError();
+}
+
+bool CompilerInstance::haveError() const {
+  return m_context && m_context->diagnostics.hasError();
+}
+
+const std::vector<std::string> &CompilerInstance::getDiagnostics() const {
+  assert(m_context && "nothing was compiled");
+  return m_context->diagnostics.getMessages();
+}
+
+ContextHolder CompilerInstance::getContext() const { return m_context; }
+
+const std::vector<Statement *> &CompilerInstance::getSyntaxTree() const {
+  assert(m_parser && "nothing was compiled");
+  return m_parser->getSyntaxTree();
+}
+
+Parser vcc::parseFile(const char *path_to_file, FileStream::Backend backend,
+                      lex::Tokenizer::Mode mode, unsigned error_limit,
+                      unsigned thread_count,
+                      std::vector<Symbol> entry_points) {
+  CompilerOptions options;
+  options.backend = backend;
+  options.mode = mode;
+  options.error_limit = error_limit;
+  options.thread_count = thread_count;
+  options.entry_points = std::move(entry_points);
+  return parseContext(std::make_shared<GlobalContext>(path_to_file, backend),
+                      options);
+}
+
+Parser vcc::parseBuffer(std::string_view buffer, std::string name,
+                        lex::Tokenizer::Mode mode, unsigned error_limit,
+                        unsigned thread_count,
+                        std::vector<Symbol> entry_points) {
+  CompilerOptions options;
+  options.mode = mode;
+  options.error_limit = error_limit;
+  options.thread_count = thread_count;
+  options.entry_points = std::move(entry_points);
+  return parseContext(
+      std::make_shared<GlobalContext>(buffer, std::move(name)), options);
+}
@@ -1,32 +1,76 @@
 #include "core/lex.h"
+#include "core/chunked_table.h"
+#include "core/scan.h"
+#include <algorithm>
 #include <assert.h>
+#include <charconv>
 #include <cstdlib>
 #include <iostream>
 #include <istream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 using namespace vcc::lex;
 
-void Tokenizer::consume() { m_current_token = readOneToken(); }
+void Tokenizer::consume() {
+  if (m_tokens) {
+    // stay at the EndOfFile token once we have reached it
+    if (m_index + 1 < m_tokens->size())
+      ++m_index;
+    return;
+  }
+
+  if (m_lookahead_count == 0) {
+    m_current_token = readOneToken();
+    return;
+  }
+
+  // the next token has already been lexed
+  m_current_token = std::move(m_lookahead[m_lookahead_begin]);
+  m_lookahead_begin = (m_lookahead_begin + 1) % LookaheadSize;
+  --m_lookahead_count;
+}
+
+Tokenizer::Tokenizer(FileStream &stream, Mode mode)
+    : m_file(stream), m_kernel(vcc::scan::getKernelTable()) {
+  if (mode == PreTokenized) {
+    m_tokens = tokenize(stream);
+    return;
+  }
 
-Tokenizer::Tokenizer(FileStream &stream) : m_file(stream) {
   m_current_token = readOneToken();
 }
 
-const Token Tokenizer::next(int n) {
-  int pos = m_file.tellg();
+Tokenizer::Tokenizer(FileStream &stream,
+                     std::shared_ptr<const TokenStream> tokens, int begin)
+    : m_file(stream), m_kernel(vcc::scan::getKernelTable()),
+      m_tokens(std::move(tokens)), m_index(begin) {
+  assert(0 <= begin && begin < m_tokens->size() && "begin is out of range");
+}
 
+const Token &Tokenizer::next(int n) {
   assert(n >= 1 && "makes no sense otherwise");
-  Token current = readOneToken();
-  for (int i = 0; i < n - 1; ++i) {
-    current = readOneToken();
+  assert(n <= LookaheadSize && "cannot look this far ahead");
+
+  if (m_tokens) {
+    int index = std::min(m_index + n, m_tokens->size() - 1);
+    m_lookahead[n - 1] = m_tokens->getToken(index);
+    return m_lookahead[n - 1];
+  }
+
+  // only lex the tokens we have not seen yet
+  while (m_lookahead_count < n) {
+    int slot = (m_lookahead_begin + m_lookahead_count) % LookaheadSize;
+    m_lookahead[slot] = readOneToken();
+    ++m_lookahead_count;
   }
 
-  m_file.seekg(pos);
-  return current;
+  return m_lookahead[(m_lookahead_begin + n - 1) % LookaheadSize];
 }
 
-static bool is_valid_stoi(const std::string &str) {
+static bool is_valid_stoi(std::string_view str) {
   for (char c : str) {
     if (!std::isdigit(c))
       return false;
@@ -35,16 +79,7 @@ static bool is_valid_stoi(const std::string &str) {
   return true;
 }
 
-const Token Tokenizer::peek() {
-  // saving the location
-  long current = m_file.tellg();
-
-  Token next_token = readOneToken();
-
-  // restoring the location
-  m_file.seekg(current);
-  return next_token;
-}
+const Token &Tokenizer::peek() { return next(1); }
 
 void Tokenizer::removeWhiteSpace() {
   if (!m_file.good())
@@ -55,7 +90,7 @@ void Tokenizer::removeWhiteSpace() {
     // skip the entire line if we see a comment
     if (peek == '#') {
       char c = m_file.get();
-      while (c != '\n') {
+      while (c != '\n' && !m_file.eof()) {
         c = m_file.get();
       }
 
@@ -70,13 +105,306 @@ void Tokenizer::removeWhiteSpace() {
   }
 }
 
+namespace {
+/// A token found by scanToken, before it is turned into a Token
+struct ScannedToken {
+  TokenType type = Invalid;
+  // the first character of the token
+  const char *begin = nullptr;
+  // the spelling of an identifier, or the content of a string
+  std::string_view spelling;
+  long long integer = 0;
+  // a string that is not closed before the end of the scanned range
+  bool is_unterminated = false;
+};
+} // namespace
+
+/// Scans the first token in [at, end), skipping white space and comments.
+/// Returns the position just past the token. Touches nothing but the buffer,
+/// so any number of ranges can be scanned at the same time
+static const char *scanToken(const vcc::scan::KernelTable &kernel,
+                             const char *at, const char *end,
+                             ScannedToken &token) {
+  // skip white space and comments, a comment runs to the end of its line
+  for (at = kernel.skip_white_space(at, end); at != end && *at == '#';
+       at = kernel.skip_white_space(at, end))
+    at = kernel.find_new_line(at, end);
+
+  token = ScannedToken();
+  token.begin = at;
+  if (at == end) {
+    token.type = EndOfFile;
+    return at;
+  }
+
+  // a string runs to the next ", there are no escapes
+  if (*at == '"') {
+    const char *close = std::find(at + 1, end, '"');
+    token.type = String;
+    token.spelling = std::string_view(at + 1, close - at - 1);
+    token.is_unterminated = close == end;
+    return std::min(close + 1, end);
+  }
+
+  if (isOneCharacterToken(*at)) {
+    token.type = lookupKeyword(std::string_view(at, 1));
+    return at + 1;
+  }
+
+  const char *word_end = kernel.find_token_end(at, end);
+  if (word_end == at) {
+    // only a stray '\0' gets here, skip it
+    return at + 1;
+  }
+
+  std::string_view word(at, word_end - at);
+
+  // this is a valid integer?
+  if (is_valid_stoi(word)) {
+    token.type = IntegerLiteral;
+    // std::stoll reports the overflow
+    if (std::from_chars(at, word_end, token.integer).ec != std::errc())
+      token.integer = std::stoll(std::string(word));
+    return word_end;
+  }
+
+  // keywords function, gives, etc.., otherwise it must be an identifier
+  token.type = lookupKeyword(word);
+  if (token.type == Invalid) {
+    token.type = Identifier;
+    token.spelling = word;
+  }
+  return word_end;
+}
+
+/// spelling is the interned spelling of an Identifier or a String
+static Token buildToken(const ScannedToken &token, long offset,
+                        vcc::Symbol spelling) {
+  switch (token.type) {
+  case Identifier:
+  case String:
+    return Token(token.type, spelling, offset);
+  case IntegerLiteral:
+    return Token(token.integer, offset);
+  default:
+    return Token(token.type, offset);
+  }
+}
+
+static bool hasSpelling(TokenType type) {
+  return type == Identifier || type == String;
+}
+
+Token Tokenizer::readOneBufferedToken() {
+  const char *begin = m_file.getBuffer();
+  const char *end = begin + m_file.getSize();
+
+  ScannedToken token;
+  const char *next = scanToken(m_kernel, begin + m_file.tellg(), end, token);
+  m_file.seekg(next - begin);
+
+  // peeking at the end sets the end of file flag, like the slow path does
+  if (token.type == EndOfFile)
+    m_file.peek();
+
+  Symbol spelling;
+  if (hasSpelling(token.type))
+    spelling = Symbol::intern(token.spelling);
+  return buildToken(token, token.begin - begin, spelling);
+}
+
+namespace {
+/// Interning takes a lock, so each lexing thread remembers the symbols it
+/// has interned already. The keys view the file buffer
+class SymbolCache {
+public:
+  vcc::Symbol intern(std::string_view spelling) {
+    auto it = m_symbols.find(spelling);
+    if (it != m_symbols.end())
+      return it->second;
+
+    vcc::Symbol symbol = vcc::Symbol::intern(spelling);
+    m_symbols.emplace(spelling, symbol);
+    return symbol;
+  }
+
+private:
+  std::unordered_map<std::string_view, vcc::Symbol> m_symbols;
+};
+} // namespace
+
+/// Lexes the tokens in [from, to) of the buffer [begin, end) into tokens,
+/// without the EndOfFile. Returns false if a string is still open at to,
+/// which means that to was not a safe place to split the buffer
+static bool lexRange(const vcc::scan::KernelTable &kernel, const char *begin,
+                     const char *end, const char *from, const char *to,
+                     TokenStream &tokens) {
+  SymbolCache symbols;
+  ScannedToken token;
+  for (const char *at = scanToken(kernel, from, to, token);
+       token.type != EndOfFile; at = scanToken(kernel, at, to, token)) {
+    if (token.is_unterminated && to != end)
+      return false;
+
+    vcc::Symbol spelling;
+    if (hasSpelling(token.type))
+      spelling = symbols.intern(token.spelling);
+    tokens.push(buildToken(token, token.begin - begin, spelling));
+  }
+  return true;
+}
+
+/// True if a top level function, struct or external declaration starts at at
+static bool startsDeclaration(const vcc::scan::KernelTable &kernel,
+                              const char *at, const char *end) {
+  const char *word_end = kernel.find_token_end(at, end);
+  TokenType type = lookupKeyword(std::string_view(at, word_end - at));
+  return type == FunctionDecl || type == Struct || type == External;
+}
+
+/// Splits [begin, end) into at most count ranges of about the same size.
+/// Every range but the first starts with a declaration keyword at column 1,
+/// which is outside of any comment, and outside of any string unless a
+/// string spans several lines. lexRange catches that last case
+static std::vector<const char *>
+splitAtDeclarations(const vcc::scan::KernelTable &kernel, const char *begin,
+                    const char *end, unsigned count) {
+  std::vector<const char *> bounds{begin};
+  for (unsigned i = 1; i < count; ++i) {
+    const char *at = std::max(bounds.back(), begin + (end - begin) * i / count);
+    while ((at = kernel.find_new_line(at, end)) != end &&
+           !startsDeclaration(kernel, at + 1, end))
+      ++at;
+    if (at == end)
+      break;
+
+    bounds.push_back(at + 1);
+  }
+  bounds.push_back(end);
+  return bounds;
+}
+
+std::shared_ptr<TokenStream> Tokenizer::tokenize(FileStream &stream,
+                                                 unsigned thread_count) {
+  std::shared_ptr<TokenStream> tokens = std::make_shared<TokenStream>();
+
+  // without the whole file in memory, lex it one token at a time
+  if (stream.getBackend() != FileStream::Buffered) {
+    Tokenizer tokenizer(stream);
+    while (tokenizer.getCurrentType() != EndOfFile) {
+      tokens->push(tokenizer.current());
+      tokenizer.consume();
+    }
+    tokens->push(tokenizer.current());
+    return tokens;
+  }
+
+  const char *begin = stream.getBuffer();
+  const char *end = begin + stream.getSize();
+  if (thread_count == 0) {
+    long by_size = (end - begin) / ParallelChunkSize;
+    long available = std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::clamp(by_size, 1l, available);
+  }
+
+  // every thread scans with the same kernel
+  const vcc::scan::KernelTable &kernel = vcc::scan::getKernelTable();
+  std::vector<const char *> bounds =
+      splitAtDeclarations(kernel, begin, end, thread_count);
+  int chunk_count = bounds.size() - 1;
+  // a single chunk is lexed in place, without a copy
+  if (chunk_count == 1) {
+    lexRange(kernel, begin, end, begin, end, *tokens);
+    tokens->push(Token(EndOfFile, end - begin));
+    return tokens;
+  }
+
+  std::vector<TokenStream> chunks(chunk_count);
+  // not a std::vector<bool>, every thread writes its own element
+  std::vector<char> is_split_safe(chunk_count);
+
+  auto lexChunk = [&](int i) {
+    is_split_safe[i] =
+        lexRange(kernel, begin, end, bounds[i], bounds[i + 1], chunks[i]);
+  };
+  std::vector<std::thread> workers;
+  for (int i = 1; i < chunk_count; ++i)
+    workers.emplace_back(lexChunk, i);
+  lexChunk(0);
+  for (std::thread &worker : workers)
+    worker.join();
+
+  for (int i = 0; i < chunk_count; ++i) {
+    if (is_split_safe[i]) {
+      tokens->append(chunks[i]);
+      continue;
+    }
+
+    // a string runs past the end of this chunk, lex the rest of the file on
+    // this thread instead
+    lexRange(kernel, begin, end, bounds[i], end, *tokens);
+    break;
+  }
+  tokens->push(Token(EndOfFile, end - begin));
+
+  return tokens;
+}
+
+int Tokenizer::relex(TokenStream &tokens, std::string_view source,
+                     const TextEdit &edit) {
+  assert(tokens.size() > 0 && tokens.getType(tokens.size() - 1) == EndOfFile &&
+         "tokens must be a whole file");
+  assert(source.substr(edit.offset, edit.inserted.size()) == edit.inserted &&
+         "source must already contain the edit");
+  const char *begin = source.data();
+  const char *end = begin + source.size();
+  long edit_end = edit.offset + edit.removed_length;
+  long shift = static_cast<long>(edit.inserted.size()) - edit.removed_length;
+
+  // Everything before the edit is unchanged, so the lexer reaches the start
+  // of the last token before the edit in the same state as before. The
+  // tokens before that one end before the edit and can be kept
+  int first = std::max(tokens.findToken(edit.offset) - 1, 0);
+  long from = tokens.getOffset(first) < edit.offset ? tokens.getOffset(first)
+                                                    : 0;
+
+  // Lex until a token starts where an old token after the edit has moved
+  // to. From there on the text, and so the tokens, are the same as before
+  int last = tokens.findToken(edit_end);
+
+  const vcc::scan::KernelTable &kernel = vcc::scan::getKernelTable();
+  TokenStream replacement;
+  ScannedToken token;
+  for (const char *at = scanToken(kernel, begin + from, end, token);;
+       at = scanToken(kernel, at, end, token)) {
+    long offset = token.begin - begin;
+    while (last < tokens.size() && tokens.getOffset(last) + shift < offset)
+      ++last;
+    if (last < tokens.size() && tokens.getOffset(last) + shift == offset)
+      break;
+
+    assert(token.type != EndOfFile && "the old EndOfFile always matches");
+    Symbol spelling;
+    if (hasSpelling(token.type))
+      spelling = Symbol::intern(token.spelling);
+    replacement.push(buildToken(token, offset, spelling));
+  }
+
+  tokens.splice(first, last, replacement, shift);
+  return replacement.size();
+}
+
 Token Tokenizer::readOneToken() {
+  // the whole file is in memory, scan it instead of going through get()
+  if (m_file.getBackend() == FileStream::Buffered)
+    return readOneBufferedToken();
+
   // put this into read one
   removeWhiteSpace();
 
-  FilePos pos = m_file.getPos();
+  long offset = m_file.tellg();
   if (m_file.eof()) {
-    return Token(EndOfFile, pos);
+    return Token(EndOfFile, offset);
   }
 
   // Important Invariant:
@@ -103,23 +431,17 @@ Token Tokenizer::readOneToken() {
       char current;
       do {
         current = m_file.get();
-        if (current != '"') {
+        if (current != '"' && !m_file.eof()) {
           buf += current;
         }
-      } while (current != '"');
-      return Token(String, buf, pos);
+      } while (current != '"' && !m_file.eof());
+      return Token(String, Symbol::intern(buf), offset);
     }
 
     // we are parsing the general one character tokens like *, -, etc
-    if (one_character_token.find(c) != one_character_token.end()) {
-      if (is_first_time) {
-        // creating the lookup term
-        std::string lookup_term;
-        lookup_term += c;
-        // making the lookup term
-        Token return_result(keyword_map.at(lookup_term), pos);
-        return return_result;
-      }
+    if (isOneCharacterToken(c)) {
+      if (is_first_time)
+        return Token(lookupKeyword(std::string_view(&c, 1)), offset);
 
       m_file.seekg(m_file.tellg() - 1);
       break;
@@ -132,41 +454,83 @@ Token Tokenizer::readOneToken() {
   // this is a valid integer?
   if (is_valid_stoi(buf)) {
     long long result = std::stoll(buf);
-    Token return_result(result, pos);
+    Token return_result(result, offset);
     return return_result;
   }
 
   // keywords function, gives, etc..
-  if (isKeyword(buf)) {
-    return Token(getKeyword(buf), pos);
+  TokenType keyword = lookupKeyword(buf);
+  if (keyword != Invalid) {
+    assert(TokenType::KeywordStart < keyword &&
+           TokenType::KeywordEnd > keyword && "this is the invarient");
+    return Token(keyword, offset);
   }
 
   // it must be an identifier than
-  return Token(std::move(buf), pos);
+  return Token(Identifier, Symbol::intern(buf), offset);
 }
 
-bool Tokenizer::isKeyword(const std::string &keyword) {
-  return keyword_map.find(keyword) != keyword_map.end();
-}
+const Token &Tokenizer::current() {
+  if (m_tokens)
+    m_current_token = m_tokens->getToken(m_index);
 
-const Token &Tokenizer::current() { return m_current_token; }
+  return m_current_token;
+}
 
-const Token Tokenizer::next() {
-  m_current_token = readOneToken();
+const Token &Tokenizer::next() {
+  consume();
 
-  return m_current_token;
+  return current();
 }
 
-TokenType Tokenizer::getKeyword(const std::string &keyword) {
-  TokenType result = keyword_map.at(keyword);
-  assert(TokenType::KeywordStart < result && TokenType::KeywordEnd > result &&
-         "this is the invarient");
+namespace {
+/// Integer literals that do not fit in the payload of a Token. They are rare,
+/// so one table is shared by every thread. Adding takes a lock, reading does
+/// not
+class LargeLiteralTable {
+public:
+  std::uint32_t add(long long value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_indices.find(value);
+    if (it != m_indices.end())
+      return it->second;
+
+    assert(m_values.size() < Token::LargeLiteralBit && "too many literals");
+    std::uint32_t index = m_values.push(value);
+    m_indices.emplace(value, index);
+    return index;
+  }
+
+  long long get(std::uint32_t index) const { return m_values.get(index); }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_indices.clear();
+    m_values.clear();
+  }
 
-  return result;
+private:
+  std::mutex m_mutex;
+  vcc::ChunkedTable<long long> m_values;
+  std::unordered_map<long long, std::uint32_t> m_indices;
+};
+
+LargeLiteralTable &getLargeLiterals() {
+  static LargeLiteralTable table;
+  return table;
+}
+} // namespace
+
+Token::Token(long long number, long offset)
+    : offset(offset), type(IntegerLiteral) {
+  assert(0 <= offset && offset <= UINT32_MAX && "file is too large");
+  if (0 <= number && number < LargeLiteralBit)
+    payload = number;
+  else
+    payload = LargeLiteralBit | getLargeLiterals().add(number);
 }
 
-Token::Token(long long number, FilePos pos)
-    : type(IntegerLiteral), integer_literal(number), pos(pos) {}
+void Token::clearLiteralTable() { getLargeLiterals().clear(); }
 
 const char *tokenTypeToString(TokenType type) {
   switch (type) {
@@ -222,51 +586,176 @@ const char *tokenTypeToString(TokenType type) {
 Token::Token() : type(Invalid) {}
 
 void Token::dump() const {
-  std::cout << "Token type: " << tokenTypeToString(type) << std::endl;
+  std::cout << "Token type: " << tokenTypeToString(getType()) << std::endl;
 }
 
-Token::Token(TokenType type, FilePos pos) : type(type), pos(pos) {
+Token::Token(TokenType type, long offset) : offset(offset), type(type) {
+  assert(0 <= offset && offset <= UINT32_MAX && "file is too large");
   assert((type == LeftParentheses || type == RightParentheses ||
-          type == EndOfFile || (type > KeywordStart && type < KeywordEnd)) &&
+          type == EndOfFile || type == Invalid ||
+          (type > KeywordStart && type < KeywordEnd)) &&
          "it must be parenthesis type style or keyword!");
 }
 
-Token::Token(std::string &&string, FilePos pos)
-    : type(Identifier), string_literal(string), pos(pos) {}
-
-Token::Token(TokenType type, std::string &string, FilePos pos)
-    : type(type), string_literal(string), pos(pos) {
+Token::Token(TokenType type, Symbol spelling, long offset)
+    : offset(offset), payload(spelling.getID()), type(type) {
+  assert(0 <= offset && offset <= UINT32_MAX && "file is too large");
   assert(type == Identifier || type == String);
 }
 
+Token Token::fromParts(TokenType type, std::uint32_t offset,
+                       std::uint32_t payload) {
+  Token token;
+  token.type = type;
+  token.offset = offset;
+  token.payload = payload;
+  return token;
+}
+
 const std::string &Token::getStringLiteral() const {
+  return getSymbol().str();
+}
+
+vcc::Symbol Token::getSymbol() const {
   assert(type == Identifier || type == String);
-  return string_literal;
+  return Symbol::fromID(payload);
 }
 
 long long Token::getIntegerLiteral() const {
   assert(type == IntegerLiteral);
-  return integer_literal;
+  if (payload & LargeLiteralBit)
+    return getLargeLiterals().get(payload & ~LargeLiteralBit);
+  return payload;
 }
 
+std::uint32_t Token::getPayload() const { return payload; }
+
 bool Token::isBinaryOperator() const {
   return type > BinaryOperatorStart && type < BinaryOperatorEnd;
 }
 
-TokenType Token::getType() const { return type; }
+TokenType Token::getType() const { return static_cast<TokenType>(type); }
 
-TokenType Tokenizer::getNextType() { return next().getType(); }
+TokenType Tokenizer::getNextType() {
+  consume();
 
-TokenType Tokenizer::getCurrentType() { return m_current_token.getType(); }
+  return getCurrentType();
+}
 
-vcc::FilePos Token::getPos() const { return pos; }
+TokenType Tokenizer::getCurrentType() {
+  if (m_tokens)
+    return m_tokens->getType(m_index);
+
+  return m_current_token.getType();
+}
+
+TokenType Tokenizer::peekType() {
+  if (m_tokens)
+    return m_tokens->getType(std::min(m_index + 1, m_tokens->size() - 1));
+
+  return peek().getType();
+}
+
+int Tokenizer::getIndex() const {
+  assert(m_tokens && "only a PreTokenized tokenizer has an index");
+  return m_index;
+}
+
+void Tokenizer::setIndex(int index) {
+  assert(m_tokens && "only a PreTokenized tokenizer has an index");
+  assert(0 <= index && index < m_tokens->size() && "index is out of range");
+  m_index = index;
+}
+
+const std::shared_ptr<const TokenStream> &Tokenizer::getTokenStream() const {
+  return m_tokens;
+}
+
+long Token::getOffset() const { return offset; }
 
 std::string Tokenizer::getLine(const FilePos &pos) {
   return m_file.getLine(pos.loc);
 }
 
+const std::string &Tokenizer::getName() const { return m_file.getName(); }
+
 bool Token::isTypeQualification() const {
   return TypeQualificationStart < getType() && getType() < TypeQualificationEnd;
 }
 
-vcc::FilePos Tokenizer::getPos() { return current().getPos(); }
+vcc::FilePos Tokenizer::getPos() {
+  if (m_tokens)
+    return m_file.getPos(m_tokens->getOffset(m_index));
+
+  return m_file.getPos(m_current_token.getOffset());
+}
+
+long Tokenizer::getOffset() {
+  if (m_tokens)
+    return m_tokens->getOffset(m_index);
+
+  return m_current_token.getOffset();
+}
+
+void TokenStream::push(const Token &token) {
+  m_types.push_back(token.getType());
+  m_offsets.push_back(token.getOffset());
+  m_payloads.push_back(token.getPayload());
+}
+
+int TokenStream::size() const { return m_types.size(); }
+
+TokenType TokenStream::getType(int index) const {
+  return static_cast<TokenType>(m_types[index]);
+}
+
+void TokenStream::splice(int first, int last, const TokenStream &replacement,
+                         long shift) {
+  assert(0 <= first && first <= last && last <= size() && "invalid range");
+
+  // the offsets after the edit move with it
+  for (int i = last; i < size(); ++i) {
+    assert(m_offsets[i] + shift >= 0 && m_offsets[i] + shift <= UINT32_MAX &&
+           "file is too large");
+    m_offsets[i] += shift;
+  }
+
+  auto replace = [&](auto &to, const auto &from) {
+    to.erase(to.begin() + first, to.begin() + last);
+    to.insert(to.begin() + first, from.begin(), from.end());
+  };
+  replace(m_types, replacement.m_types);
+  replace(m_offsets, replacement.m_offsets);
+  replace(m_payloads, replacement.m_payloads);
+}
+
+void TokenStream::append(const TokenStream &other) {
+  m_types.insert(m_types.end(), other.m_types.begin(), other.m_types.end());
+  m_offsets.insert(m_offsets.end(), other.m_offsets.begin(),
+                   other.m_offsets.end());
+  m_payloads.insert(m_payloads.end(), other.m_payloads.begin(),
+                    other.m_payloads.end());
+}
+
+int TokenStream::findToken(long offset) const {
+  return std::lower_bound(m_offsets.begin(), m_offsets.end(), offset) -
+         m_offsets.begin();
+}
+
+long TokenStream::getOffset(int index) const { return m_offsets[index]; }
+
+const std::string &TokenStream::getStringLiteral(int index) const {
+  return getSymbol(index).str();
+}
+
+vcc::Symbol TokenStream::getSymbol(int index) const {
+  return getToken(index).getSymbol();
+}
+
+long long TokenStream::getIntegerLiteral(int index) const {
+  return getToken(index).getIntegerLiteral();
+}
+
+Token TokenStream::getToken(int index) const {
+  return Token::fromParts(getType(index), m_offsets[index], m_payloads[index]);
+}
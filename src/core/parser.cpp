@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <deque>
 #include <iostream>
+#include <numeric>
+#include <thread>
 
 #include "core/parser.h"
 #include "core/ast.h"
@@ -7,20 +12,49 @@
 using namespace vcc;
 using vcc::lex::Token;
 
-Parser::Parser(ContextHolder context)
-    : m_tokenizer(context->stream), m_context(context) {}
+/// function bodies can only be parsed in parallel out of a buffer, the other
+/// backends read the file while diagnosing
+static unsigned getThreadCount(ContextHolder context, unsigned thread_count) {
+  if (context->getMainStream().getBackend() != FileStream::Buffered)
+    return 1;
+  return thread_count;
+}
+
+Parser::Parser(ContextHolder context, lex::Tokenizer::Mode mode,
+               unsigned thread_count, std::vector<Symbol> entry_points)
+    : m_context(context), m_file(context->main_file),
+      m_tokenizer(context->sources.getStream(context->main_file),
+                  getThreadCount(context, thread_count) == 1 &&
+                          entry_points.empty()
+                      ? mode
+                      : lex::Tokenizer::PreTokenized),
+      m_ast(&context->ast), m_diagnostics(&context->diagnostics),
+      m_thread_count(getThreadCount(context, thread_count)),
+      m_entry_points(std::move(entry_points)) {}
+
+Parser::Parser(const Parser &parent, ASTContext &ast)
+    : m_context(parent.m_context), m_file(parent.m_file),
+      m_tokenizer(parent.m_context->sources.getStream(parent.m_file),
+                  parent.m_tokenizer.getTokenStream()),
+      m_ast(&ast), m_diagnostics(nullptr), m_thread_count(1),
+      m_struct_defs(parent.m_struct_defs) {}
 
 void Parser::start() {
-  static bool started_before = false;
-  if (!started_before) {
-    buildSyntaxTree();
-    started_before = true;
-  }
+  if (m_started)
+    return;
+  m_started = true;
+  buildSyntaxTree();
+  m_context->ast.endPhase("parse");
+
+  // the declarations that parsed are checked even if others did not, so that
+  // syntax and type errors are all reported in one run
+  m_actions.analyze(m_context, m_top_level_statements);
+  m_context->ast.endPhase("sema");
 }
 
 /// if the next token is either '.' or '[' we have another posfix expression
-inline static bool isFullstopOrLeftBracket(const Token &next) {
-  if (next.getType() == lex::Fullstop || next.getType() == lex::LeftBracket)
+inline static bool isFullstopOrLeftBracket(lex::TokenType next) {
+  if (next == lex::Fullstop || next == lex::LeftBracket)
     return true;
 
   return false;
@@ -38,29 +72,29 @@ Type *Parser::buildTypeQualification() {
   // we have a boolean type here
   if (m_tokenizer.getCurrentType() == lex::Bool) {
     m_tokenizer.consume();
-    return new BuiltinType(BuiltinType::Bool);
+    return m_context->types->getBuiltinType(BuiltinType::Bool);
   }
 
   if (m_tokenizer.getCurrentType() == lex::Long) {
     m_tokenizer.consume();
-    return new BuiltinType(BuiltinType::Long);
+    return m_context->types->getBuiltinType(BuiltinType::Long);
   }
 
   if (m_tokenizer.getCurrentType() == lex::Short) {
     m_tokenizer.consume();
-    return new BuiltinType(BuiltinType::Long);
+    return m_context->types->getBuiltinType(BuiltinType::Long);
   }
 
   // we have void type 'void'
   if (m_tokenizer.getCurrentType() == lex::Void) {
     m_tokenizer.consume();
-    return new VoidType();
+    return m_context->types->getVoidType();
   }
 
   // 'char'
   if (m_tokenizer.getCurrentType() == lex::Char) {
     m_tokenizer.consume();
-    return new BuiltinType(BuiltinType::Char);
+    return m_context->types->getBuiltinType(BuiltinType::Char);
   }
 
   // we have an array type
@@ -83,28 +117,32 @@ Type *Parser::buildTypeQualification() {
     m_tokenizer.consume();
 
     Type *base = buildTypeQualification();
-    return new ArrayType(base, count);
+    if (!base)
+      return nullptr;
+    return m_context->types->getArrayType(base, count);
   }
 
   // 'ptr', <type_qualification>
   if (m_tokenizer.getCurrentType() == lex::Ptr) {
     m_tokenizer.consume();
     Type *pointee = buildTypeQualification();
-    return new PointerType(pointee);
+    if (!pointee)
+      return nullptr;
+    return m_context->types->getPointerType(pointee);
   }
 
   // we have builtin
   if (m_tokenizer.getCurrentType() == lex::Int) {
     m_tokenizer.consume();
 
-    return new BuiltinType(BuiltinType::Int);
+    return m_context->types->getBuiltinType(BuiltinType::Int);
   }
 
   // we have float builtin
   if (m_tokenizer.getCurrentType() == lex::Float) {
     m_tokenizer.consume();
 
-    return new BuiltinType(BuiltinType::Float);
+    return m_context->types->getBuiltinType(BuiltinType::Float);
   }
   // we have a structure
   if (m_tokenizer.getCurrentType() == lex::Struct) {
@@ -113,15 +151,16 @@ Type *Parser::buildTypeQualification() {
       return logError("expected identifier");
     }
 
-    std::string struct_name = m_tokenizer.current().getStringLiteral();
+    Symbol struct_name = m_tokenizer.current().getSymbol();
+    auto it = m_struct_defs.find(struct_name);
+    if (it == m_struct_defs.end())
+      return logError("undefined struct");
     m_tokenizer.consume();
 
-    assert(m_struct_defs.find(struct_name)  != m_struct_defs.end() &&
-           "undefined reference to struct");
-    return m_struct_defs[struct_name];
+    return it->second;
   }
 
-  return nullptr;
+  return logError("expected a type");
 }
 
 // struct_definition :== 'struct', <identifier> ,'{'
@@ -136,7 +175,7 @@ void Parser::addStructDefinition() {
     logError("expected identifier");
     return;
   }
-  std::string name = m_tokenizer.current().getStringLiteral();
+  Symbol name = m_tokenizer.current().getSymbol();
 
   if (m_tokenizer.getNextType() != lex::LeftBrace) {
     logError("expected {");
@@ -147,14 +186,18 @@ void Parser::addStructDefinition() {
   // parsing the struct
   std::vector<StructType::Element> elements;
   int element_count = 0;
-  while (Type *current = buildTypeQualification()) {
+  while (m_tokenizer.current().isTypeQualification()) {
+    Type *current = buildTypeQualification();
+    if (!current)
+      return;
+
     if (m_tokenizer.getCurrentType() != lex::Identifier) {
       logError("expected identifier");
       return;
     }
 
     // FIXME: we need to check that there are no duplicated name
-    std::string name = m_tokenizer.current().getStringLiteral();
+    Symbol name = m_tokenizer.current().getSymbol();
     elements.push_back({element_count, name, current});
     if (m_tokenizer.getNextType() != lex::Comma) {
       logError("expected ,");
@@ -173,9 +216,11 @@ void Parser::addStructDefinition() {
   m_tokenizer.consume();
 
   // Finally, inserting the element into the table
-  assert(m_struct_defs.find(name) == m_struct_defs.end() &&
-         "we have duplicated definition of the same struct");
-  m_struct_defs[name] = new StructType(elements, name);
+  if (m_struct_defs.find(name) != m_struct_defs.end()) {
+    logError("redefinition of struct");
+    return;
+  }
+  m_struct_defs[name] = m_context->types->createStructType(elements, name);
 }
 
 // external_decl :== 'extern', 'function', <identifier>,
@@ -183,7 +228,7 @@ void Parser::addStructDefinition() {
 Statement *Parser::buildExternalDecl() {
   if (m_tokenizer.getCurrentType() != lex::External)
     return logError("expected extern");
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   m_tokenizer.consume();
 
   if (m_tokenizer.getCurrentType() != lex::FunctionDecl)
@@ -192,7 +237,7 @@ Statement *Parser::buildExternalDecl() {
 
   if (m_tokenizer.getCurrentType() != lex::Identifier)
     return logError("expected identifier");
-  std::string name = m_tokenizer.current().getStringLiteral();
+  Symbol name = m_tokenizer.current().getSymbol();
   m_tokenizer.consume();
 
   if (m_tokenizer.getCurrentType() != lex::Gives)
@@ -200,48 +245,141 @@ Statement *Parser::buildExternalDecl() {
   m_tokenizer.consume();
 
   Type *return_type = buildTypeQualification();
+  if (!return_type)
+    return nullptr;
+
   ASTBase *function_arg_list = buildFunctionArgList();
+  if (!function_arg_list)
+    return nullptr;
 
   std::vector<Statement *> statements{};
 
-  return new FunctionDecl(
-      statements, dyncast<FunctionArgLists>(function_arg_list), std::move(name),
-      return_type, /*is_extern*/ true, locus);
+  return create<FunctionDecl>(statements,
+                              dyncast<FunctionArgLists>(function_arg_list),
+                              name, return_type, /*is_extern*/ true, locus);
 }
 
 // top_level :== <function_decl> | <struct_definition> | <external_decl>
 const std::vector<Statement *> &Parser::buildSyntaxTree() {
   assert(m_top_level_statements.size() == 0 && "can only be called once");
-  while (m_tokenizer.getCurrentType() != lex::EndOfFile) {
+  // when the bodies are parsed later, the errors found before are held back
+  // to be reported in source order with theirs
+  DiagnosticDriver held_back(m_context->sources, /*buffered*/ true);
+  if (defersBodies())
+    m_diagnostics = &held_back;
+
+  while (m_tokenizer.getCurrentType() != lex::EndOfFile && !shouldStop()) {
+    Statement *declaration = nullptr;
     if (m_tokenizer.getCurrentType() == lex::FunctionDecl) {
-      Statement *base = buildFunctionDecl();
-      m_top_level_statements.push_back(base);
-      continue;
+      if (!defersBodies())
+        declaration = buildFunctionDecl();
+      else if (deferFunctionDecl())
+        continue;
+    } else if (m_tokenizer.getCurrentType() == lex::External) {
+      declaration = buildExternalDecl();
+    } else if (m_tokenizer.getCurrentType() == lex::Struct) {
+      unsigned error_count = m_diagnostics->getErrorCount();
+      addStructDefinition();
+      if (m_diagnostics->getErrorCount() == error_count)
+        continue;
+    } else {
+      logError("cannot parse things starting here");
     }
 
-    if (m_tokenizer.getCurrentType() == lex::Struct) {
-      addStructDefinition();
+    // the rest of a broken declaration would only cause more errors
+    if (!declaration) {
+      synchronizeTopLevel();
       continue;
     }
+    m_top_level_statements.push_back(declaration);
+  }
 
-    if (m_tokenizer.getCurrentType() == lex::External) {
-      Statement *exteran_decl = buildExternalDecl();
-      m_top_level_statements.push_back(exteran_decl);
-      continue;
+  if (defersBodies()) {
+    if (m_entry_points.empty()) {
+      std::vector<int> all(m_pending_bodies.size());
+      std::iota(all.begin(), all.end(), 0);
+      parseBodies(all);
+    } else {
+      parseReachableBodies();
     }
 
-    break;
+    m_diagnostics = &m_context->diagnostics;
+    mergeBodies();
+    // the sequential parser would not have seen the errors after the limit
+    if (!m_diagnostics->reachedErrorLimit())
+      m_diagnostics->takeDiagnostics(held_back);
   }
+  return m_top_level_statements;
+}
 
-  if (m_tokenizer.getCurrentType() != lex::EndOfFile) {
-    logError("cannot parse things starting here");
+/// the tokens that can start a declaration at the top level, struct is left
+/// out as it also starts the type of a local variable
+static bool isTopLevelKeyword(lex::TokenType type) {
+  return type == lex::FunctionDecl || type == lex::External;
+}
+
+void Parser::synchronizeStatement() {
+  while (true) {
+    lex::TokenType type = m_tokenizer.getCurrentType();
+    if (type == lex::EndOfFile || type == lex::End ||
+        type == lex::RightBrace || isTopLevelKeyword(type))
+      return;
+
+    m_tokenizer.consume();
+    if (type == lex::SemiColon)
+      return;
   }
+}
 
-  return m_top_level_statements;
+void Parser::synchronizeTopLevel() {
+  while (true) {
+    lex::TokenType type = m_tokenizer.getCurrentType();
+    if (type == lex::EndOfFile || isTopLevelKeyword(type))
+      return;
+
+    m_tokenizer.consume();
+    if (type == lex::RightBrace)
+      return;
+  }
+}
+
+bool Parser::shouldStop() const {
+  // the buffered drivers of deferred bodies have no limit of their own, but
+  // the errors they hold back count towards the one of the context
+  unsigned limit = m_context->diagnostics.getErrorLimit();
+  return limit && m_diagnostics->getErrorCount() > limit;
+}
+
+void Parser::buildStatements(std::vector<Statement *> &statements,
+                             lex::TokenType terminator) {
+  bool recovered = false;
+  while (!shouldStop()) {
+    lex::TokenType type = m_tokenizer.getCurrentType();
+    // a '}' ends an if or while that is missing its 'end' as well
+    if (type == terminator || type == lex::RightBrace ||
+        type == lex::EndOfFile || isTopLevelKeyword(type))
+      return;
+
+    // an 'end' in a function body, after an error it is most likely left
+    // over from an if or while whose header could not be parsed
+    if (type == lex::End && terminator != lex::End) {
+      if (!recovered)
+        logError("unexpected end");
+      m_tokenizer.consume();
+      continue;
+    }
+
+    if (Statement *statement = buildStatement()) {
+      statements.push_back(statement);
+      continue;
+    }
+    synchronizeStatement();
+    recovered = true;
+  }
 }
 
 inline Parser::ErrorResult Parser::logError(const std::string &message) {
-  m_context->diagnostics.diag(m_tokenizer, message);
+  m_diagnostics->diag(m_tokenizer, message);
   return ErrorResult();
 }
 
@@ -250,25 +388,25 @@ Statement *Parser::buildIfStatement() {
   if (m_tokenizer.getCurrentType() != lex::If)
     return logError("expected if");
 
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   m_tokenizer.consume();
 
   Expression *cond = buildExpression();
+  if (!cond)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::Then)
     return logError("expected then");
   m_tokenizer.consume();
 
   std::vector<Statement *> expressions;
-  while (Statement *expression = buildStatement()) {
-    expressions.push_back(expression);
-  }
+  buildStatements(expressions, lex::End);
 
   if (m_tokenizer.getCurrentType() != lex::End)
     return logError("expected end");
   m_tokenizer.consume();
 
-  return new IfStatement(cond, std::move(expressions), locus);
+  return create<IfStatement>(cond, std::move(expressions), locus);
 }
 
 // while_statement :== 'while', <expression> 'then', <statements>+,'end'
@@ -276,44 +414,45 @@ Statement *Parser::buildWhileStatement() {
   if (m_tokenizer.getCurrentType() != lex::While)
     return logError("expected while");
   m_tokenizer.consume();
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
 
   Expression *cond = buildExpression();
+  if (!cond)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::Then)
     return logError("expected then");
   m_tokenizer.consume();
 
   std::vector<Statement *> expressions{};
-  while (Statement *statement = buildStatement())
-    expressions.push_back(statement);
+  buildStatements(expressions, lex::End);
 
   if (m_tokenizer.getCurrentType() != lex::End)
     return logError("expected end");
   m_tokenizer.consume();
 
-  return new WhileStatement(cond, std::move(expressions), locus);
+  return create<WhileStatement>(cond, std::move(expressions), locus);
 }
 
 // call_statement :== <call_expression>, ';'
 Statement *Parser::buildCallStatement() {
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   Expression *call_expresion = buildCallExpr();
+  if (!call_expresion)
+    return nullptr;
+
   if (m_tokenizer.getCurrentType() != lex::SemiColon) {
     return logError("expected semi colon");
   }
   m_tokenizer.consume();
 
-  return new CallStatement(call_expresion, locus);
+  return create<CallStatement>(call_expresion, locus);
 }
 
 // statements :== <assignment_statement> | <return_statement> | <if_statement> |
 // <while_statement>
 //         | <declaration_statement> | <call_statement>
 Statement *Parser::buildStatement() {
-  if (m_tokenizer.getCurrentType() == lex::RightBrace)
-    return nullptr;
-
   if (m_tokenizer.getCurrentType() == lex::If)
     return buildIfStatement();
 
@@ -324,7 +463,7 @@ Statement *Parser::buildStatement() {
     return buildDeclarationStatement();
 
   if (m_tokenizer.getCurrentType() == lex::Identifier &&
-      m_tokenizer.peek().getType() == lex::LeftParentheses) {
+      m_tokenizer.peekType() == lex::LeftParentheses) {
     return buildCallStatement();
   }
 
@@ -337,65 +476,213 @@ Statement *Parser::buildStatement() {
 // function_decl :== 'function', <identifier>, 'gives', <type_qualification>,
 //                     <function_args_list>, '{', <expression>+, ''}'
 Statement *Parser::buildFunctionDecl() {
-  if (m_tokenizer.current().getType() != lex::FunctionDecl)
-    return logError("function declaration must begin with keyword function");
+  FunctionHeader header;
+  if (!buildFunctionHeader(header))
+    return nullptr;
 
-  FilePos locus = m_tokenizer.getPos();
+  return buildFunctionBody(header);
+}
+
+bool Parser::buildFunctionHeader(FunctionHeader &header) {
+  if (m_tokenizer.current().getType() != lex::FunctionDecl) {
+    logError("function declaration must begin with keyword function");
+    return false;
+  }
+
+  header.locus = getLocation();
   // eat function decl
   Token name_token = m_tokenizer.next();
-  if (name_token.getType() != lex::Identifier)
-    return logError("function declaration does not have identifier");
+  if (name_token.getType() != lex::Identifier) {
+    logError("function declaration does not have identifier");
+    return false;
+  }
 
-  std::string name = name_token.getStringLiteral();
+  header.name = name_token.getSymbol();
 
-  if (m_tokenizer.getNextType() != lex::Gives)
-    return logError("function declaration must provide return type");
+  if (m_tokenizer.getNextType() != lex::Gives) {
+    logError("function declaration must provide return type");
+    return false;
+  }
   m_tokenizer.consume();
 
-  Type *return_type = buildTypeQualification();
+  header.return_type = buildTypeQualification();
+  if (!header.return_type)
+    return false;
 
-  FunctionArgLists *arg_list = buildFunctionArgList();
+  header.arg_list = buildFunctionArgList();
+  if (!header.arg_list)
+    return false;
 
-  if (m_tokenizer.getCurrentType() != lex::LeftBrace)
-    return logError("expected {");
+  if (m_tokenizer.getCurrentType() != lex::LeftBrace) {
+    logError("expected {");
+    return false;
+  }
   m_tokenizer.consume();
+  return true;
+}
 
-  // currently only assignment expression is supported
-  Statement *exp;
+Statement *Parser::buildFunctionBody(const FunctionHeader &header) {
+  unsigned error_count = m_diagnostics->getErrorCount();
   std::vector<Statement *> expressions;
-  while ((exp = buildStatement())) {
-    assert(exp && "expression must be non nullptr");
-    expressions.push_back(exp);
-  }
+  buildStatements(expressions, lex::RightBrace);
 
   if (m_tokenizer.getCurrentType() != lex::RightBrace)
     return logError("expected }");
   m_tokenizer.consume();
 
-  return new FunctionDecl(
-      expressions, dynamic_cast<FunctionArgLists *>(arg_list), std::move(name),
-      return_type, /*is_extern*/ false, locus);
+  FunctionDecl *decl = create<FunctionDecl>(
+      expressions, header.arg_list, header.name, header.return_type,
+      /*is_extern*/ false, header.locus);
+  // the statements that were dropped would make Sema report errors that are
+  // only caused by them
+  if (m_diagnostics->getErrorCount() != error_count)
+    decl->setInvalid();
+  return decl;
+}
+
+bool Parser::deferFunctionDecl() {
+  FunctionHeader header;
+  if (!buildFunctionHeader(header))
+    return false;
+
+  m_pending_bodies.push_back({header, m_tokenizer.getIndex(),
+                              m_top_level_statements.size(),
+                              m_diagnostics->getErrorCount(),
+                              DiagnosticDriver(m_context->sources, true),
+                              DiagnosticDriver(m_context->sources, true),
+                              /*declaration*/ nullptr, /*callees*/ {}});
+  m_pending_bodies.back().preceding.takeDiagnostics(*m_diagnostics);
+  m_top_level_statements.push_back(nullptr);
+
+  // a body has no braces of its own, it ends where buildStatements stops
+  synchronizeTopLevel();
+  return true;
+}
+
+bool Parser::defersBodies() const {
+  return m_thread_count != 1 || !m_entry_points.empty();
+}
+
+void Parser::parseBodies(const std::vector<int> &indices) {
+  int body_count = indices.size();
+  unsigned thread_count = m_thread_count;
+  if (thread_count == 0)
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  thread_count = std::min<unsigned>(thread_count, std::max(body_count, 1));
+
+  // this thread allocates out of the arena of the context, the others out of
+  // their own until they are done
+  std::deque<ASTContext> arenas(thread_count - 1);
+  std::atomic<int> next_body = 0;
+  // the errors of the bodies parsed so far, by every thread
+  std::atomic<unsigned> body_errors = m_body_errors;
+  unsigned limit = m_context->diagnostics.getErrorLimit();
+  auto parseSome = [&](ASTContext &arena) {
+    Parser worker(*this, arena);
+    for (int i = next_body++; i < body_count; i = next_body++) {
+      PendingBody &body = m_pending_bodies[indices[i]];
+      // stop once the errors are past the limit. Without entry points the
+      // bodies are handed out in source order, so mergeBodies drops the rest
+      if (limit && body.errors_before + body_errors > limit)
+        break;
+      worker.m_tokenizer.setIndex(body.begin);
+      worker.m_diagnostics = &body.diagnostics;
+      worker.m_callees = &body.callees;
+      body.declaration = worker.buildFunctionBody(body.header);
+      body_errors += body.diagnostics.getErrorCount();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (ASTContext &arena : arenas)
+    workers.emplace_back(parseSome, std::ref(arena));
+  parseSome(m_context->ast);
+  for (std::thread &worker : workers)
+    worker.join();
+
+  for (ASTContext &arena : arenas)
+    m_context->ast.adopt(arena);
+  m_body_errors = body_errors;
+}
+
+void Parser::parseReachableBodies() {
+  std::unordered_map<Symbol, int> body_of;
+  for (std::size_t i = 0; i < m_pending_bodies.size(); ++i)
+    body_of[m_pending_bodies[i].header.name] = i;
+
+  // the bodies of a level are all parsed before their callees are looked at,
+  // so that a level can be spread over the threads
+  std::vector<int> level;
+  auto request = [&](Symbol name) {
+    auto it = body_of.find(name);
+    // externs and undefined functions have no body
+    if (it == body_of.end())
+      return;
+    level.push_back(it->second);
+    body_of.erase(it);
+  };
+  for (Symbol entry_point : m_entry_points) {
+    if (!body_of.count(entry_point))
+      m_diagnostics->diag("undefined entry point: " + entry_point.str());
+  }
+  for (Symbol entry_point : m_entry_points)
+    request(entry_point);
+
+  while (!level.empty()) {
+    std::vector<int> parsing = std::move(level);
+    level.clear();
+    parseBodies(parsing);
+    for (int index : parsing)
+      for (Symbol callee : m_pending_bodies[index].callees)
+        request(callee);
+  }
+}
+
+void Parser::mergeBodies() {
+  // merged in source order, dropping the bodies that failed to parse or that
+  // are not reachable. Once the errors are past the limit the rest is dropped
+  // too, where the sequential parser would have stopped
+  DiagnosticDriver &diagnostics = m_context->diagnostics;
+  for (PendingBody &body : m_pending_bodies) {
+    diagnostics.takeDiagnostics(body.preceding);
+    diagnostics.takeDiagnostics(body.diagnostics);
+    if (diagnostics.reachedErrorLimit()) {
+      m_top_level_statements.resize(body.slot);
+      break;
+    }
+    m_top_level_statements[body.slot] = body.declaration;
+  }
+  m_pending_bodies.clear();
+  m_top_level_statements.erase(std::remove(m_top_level_statements.begin(),
+                                           m_top_level_statements.end(),
+                                           nullptr),
+                               m_top_level_statements.end());
 }
 
 // assignment_statement :== <trivial_expression> ,'=' <expression>, ';'
 Statement *Parser::buildAssignmentStatement() {
-  FilePos locus = m_tokenizer.getPos();
-  LocatorExpression *lhs = dyncast<LocatorExpression>(buildTrivialExpression());
-  if (!lhs)
+  SourceLocation locus = getLocation();
+  Expression *trivial_expression = buildTrivialExpression();
+  if (!trivial_expression)
     return nullptr;
 
+  LocatorExpression *lhs = dyncast<LocatorExpression>(trivial_expression);
+  if (!lhs)
+    return logError("cannot assign to this expression");
+
   if (m_tokenizer.getCurrentType() != lex::Equal)
     return logError("expected =");
   m_tokenizer.consume();
 
   Expression *expression = buildExpression();
+  if (!expression)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::SemiColon)
     return logError("expected semi colon");
 
   m_tokenizer.consume();
 
-  return new AssignmentStatement(lhs, expression, locus);
+  return create<AssignmentStatement>(lhs, expression, locus);
 }
 
 // FIXME: maybe put arg_declaration into its own function?
@@ -407,20 +694,22 @@ FunctionArgLists *Parser::buildFunctionArgList() {
     return nullptr;
   }
   m_tokenizer.consume();
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
 
   // parsing args declaration
   // FIXME: add a way to map token into type qualification
   std::vector<TypeInfo> args{};
   while (m_tokenizer.current().isTypeQualification()) {
     Type *type = buildTypeQualification();
+    if (!type)
+      return nullptr;
     lex::Token next_token = m_tokenizer.current();
 
     if (next_token.getType() != lex::Identifier) {
       logError("expected identifier");
       return nullptr;
     }
-    std::string name = next_token.getStringLiteral();
+    Symbol name = next_token.getSymbol();
 
     if (m_tokenizer.getNextType() != lex::Comma) {
       logError("expected comma");
@@ -438,12 +727,12 @@ FunctionArgLists *Parser::buildFunctionArgList() {
   // pop this token ]
   m_tokenizer.consume();
 
-  return new FunctionArgLists(std::move(args), locus);
+  return create<FunctionArgLists>(std::move(args), locus);
 }
 
 // return_statement :== 'ret', {<expression>} ';'
 Statement *Parser::buildReturnStatement() {
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   if (m_tokenizer.getCurrentType() != lex::Ret) {
     return logError("expected error");
   }
@@ -452,15 +741,18 @@ Statement *Parser::buildReturnStatement() {
   Expression *expression = nullptr;
   // Parser an expression if and only if we don't have an ';'
   //  if we have an ';', it is likely that we have a void function type
-  if (m_tokenizer.getCurrentType() != lex::SemiColon)
+  if (m_tokenizer.getCurrentType() != lex::SemiColon) {
     expression = buildExpression();
+    if (!expression)
+      return nullptr;
+  }
 
   if (m_tokenizer.getCurrentType() != lex::SemiColon) {
     return logError("expected ;");
   }
   m_tokenizer.consume();
 
-  return new ReturnStatement(expression, locus);
+  return create<ReturnStatement>(expression, locus);
 }
 
 // expression :==  <binary_expression>
@@ -488,7 +780,8 @@ Expression *Parser::buildBinaryExpression(int min_precendence) {
   // return result
 
   Expression *result = buildTrivialExpression();
-  assert(result && "not sure how can this be false?");
+  if (!result)
+    return nullptr;
 
   // this is just a trivial expression case
   Token current_operator_token = m_tokenizer.current();
@@ -497,7 +790,7 @@ Expression *Parser::buildBinaryExpression(int min_precendence) {
   }
 
   int current_precedence_level =
-      precedence_level.find(current_operator_token.getType())->second;
+      lex::getPrecedence(current_operator_token.getType());
   while (current_precedence_level >= min_precendence) {
     current_operator_token = m_tokenizer.current();
     // at the beginning of every loop iteration, the current token
@@ -508,17 +801,19 @@ Expression *Parser::buildBinaryExpression(int min_precendence) {
       break;
 
     current_precedence_level =
-        precedence_level.find(current_operator_token.getType())->second;
+        lex::getPrecedence(current_operator_token.getType());
 
-    result = new BinaryExpression(
+    result = create<BinaryExpression>(
         result, BinaryExpression::getFromLexType(current_operator_token),
-        current_operator_token.getPos());
+        getLocation(current_operator_token));
     m_tokenizer.consume(); // consume the binary token
 
     int next_precedence_level = current_precedence_level + 1;
 
     Expression *rhs = buildBinaryExpression(next_precedence_level);
-    dynamic_cast<BinaryExpression *>(result)->setRHS(rhs);
+    if (!rhs)
+      return nullptr;
+    dyncast<BinaryExpression>(result)->setRHS(rhs);
   }
 
   return result;
@@ -546,9 +841,9 @@ static void appendChild(LocatorExpression *expression,
 //     <postfix_expression>, '.', <identifier> |
 //     <postfix_expression>, '[', <expression>, ']'
 LocatorExpression *Parser::buildTailPosfixExpression(LocatorExpression *lhs) {
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   assert(lhs && "we must have a parent if we made it here");
-  assert(isFullstopOrLeftBracket(m_tokenizer.current()));
+  assert(isFullstopOrLeftBracket(m_tokenizer.getCurrentType()));
   if (m_tokenizer.getCurrentType() == lex::Fullstop) {
     m_tokenizer.consume();
     if (m_tokenizer.getCurrentType() != lex::Identifier) {
@@ -556,14 +851,14 @@ LocatorExpression *Parser::buildTailPosfixExpression(LocatorExpression *lhs) {
       return nullptr;
     }
 
-    std::string member = m_tokenizer.current().getStringLiteral();
+    Symbol member = m_tokenizer.current().getSymbol();
     m_tokenizer.consume();
 
     MemberAccessExpression *expression =
-        new MemberAccessExpression(lhs, member, locus);
+        create<MemberAccessExpression>(lhs, member, locus);
     appendChild(lhs, expression); // building the syntax tree
 
-    if (isFullstopOrLeftBracket(m_tokenizer.current()))
+    if (isFullstopOrLeftBracket(m_tokenizer.getCurrentType()))
       buildPosfixExpression(expression);
 
     return expression;
@@ -579,6 +874,8 @@ LocatorExpression *Parser::buildTailPosfixExpression(LocatorExpression *lhs) {
   }
   m_tokenizer.consume();
   Expression *expression = buildExpression();
+  if (!expression)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::RightBracket) {
     logError("expected identifier");
@@ -586,9 +883,9 @@ LocatorExpression *Parser::buildTailPosfixExpression(LocatorExpression *lhs) {
   }
   m_tokenizer.consume();
   ArrayAccessExpression *new_expression =
-      new ArrayAccessExpression(lhs, expression, locus);
+      create<ArrayAccessExpression>(lhs, expression, locus);
   appendChild(lhs, new_expression); // building the syntax tree
-  if (isFullstopOrLeftBracket(m_tokenizer.current()))
+  if (isFullstopOrLeftBracket(m_tokenizer.getCurrentType()))
     buildPosfixExpression(new_expression);
   return new_expression;
 }
@@ -599,15 +896,17 @@ LocatorExpression *Parser::buildTailPosfixExpression(LocatorExpression *lhs) {
 LocatorExpression *Parser::buildPosfixExpression(LocatorExpression *lhs) {
   //     <postfix_expression>, '.', <identifier> |
   //     <postfix_expression>, '[', <expression>, ']'
-  if (isFullstopOrLeftBracket(m_tokenizer.current())) {
+  if (isFullstopOrLeftBracket(m_tokenizer.getCurrentType())) {
     return buildTailPosfixExpression(lhs);
   }
-  FilePos filepos = m_tokenizer.getPos();
+  SourceLocation filepos = getLocation();
 
   // the <deref_expression> case
   if (m_tokenizer.getCurrentType() == lex::Deref) {
     LocatorExpression *deref_expression =
         dyncast<LocatorExpression>(buildDerefExpression());
+    if (!deref_expression)
+      return nullptr;
     return buildTailPosfixExpression(deref_expression);
   }
 
@@ -616,7 +915,7 @@ LocatorExpression *Parser::buildPosfixExpression(LocatorExpression *lhs) {
     logError("expected identifier");
     return nullptr;
   }
-  std::string name = m_tokenizer.current().getStringLiteral();
+  Symbol name = m_tokenizer.current().getSymbol();
   m_tokenizer.consume();
 
   if (m_tokenizer.getCurrentType() != lex::Fullstop &&
@@ -629,6 +928,8 @@ LocatorExpression *Parser::buildPosfixExpression(LocatorExpression *lhs) {
   if (m_tokenizer.getCurrentType() == lex::LeftBracket) {
     m_tokenizer.consume();
     Expression *expresion = buildExpression();
+    if (!expresion)
+      return nullptr;
 
     if (m_tokenizer.getCurrentType() != lex::RightBracket) {
       logError("expected either . or [");
@@ -637,8 +938,8 @@ LocatorExpression *Parser::buildPosfixExpression(LocatorExpression *lhs) {
     m_tokenizer.consume();
 
     ArrayAccessExpression *array_access =
-        new ArrayAccessExpression(name, expresion, filepos);
-    if (isFullstopOrLeftBracket(m_tokenizer.current()))
+        create<ArrayAccessExpression>(name, expresion, filepos);
+    if (isFullstopOrLeftBracket(m_tokenizer.getCurrentType()))
       buildPosfixExpression(array_access);
     return array_access;
   }
@@ -652,19 +953,19 @@ LocatorExpression *Parser::buildPosfixExpression(LocatorExpression *lhs) {
     return nullptr;
   }
 
-  std::string literal = m_tokenizer.current().getStringLiteral();
+  Symbol literal = m_tokenizer.current().getSymbol();
   m_tokenizer.consume();
 
   MemberAccessExpression *access =
-      new MemberAccessExpression(name, literal, filepos);
-  if (isFullstopOrLeftBracket(m_tokenizer.current()))
+      create<MemberAccessExpression>(name, literal, filepos);
+  if (isFullstopOrLeftBracket(m_tokenizer.getCurrentType()))
     buildPosfixExpression(access);
   return access;
 }
 
 // ref_expression :== 'ref', '<', <trivial_expression>, '>'
 Expression *Parser::buildRefExpression() {
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   if (m_tokenizer.getCurrentType() != lex::Ref) {
     logError("expected ref");
     return nullptr;
@@ -677,6 +978,8 @@ Expression *Parser::buildRefExpression() {
   m_tokenizer.consume();
 
   Expression *expression = buildTrivialExpression();
+  if (!expression)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::GreaterSign) {
     logError("expected >");
@@ -684,13 +987,13 @@ Expression *Parser::buildRefExpression() {
   }
   m_tokenizer.consume();
 
-  return new RefExpression(expression, locus);
+  return create<RefExpression>(expression, locus);
 }
 
 // cast_expression :== 'cast', '<', <type_qualification> '>', '(',
 // <expression>,')'
 Expression *Parser::buildCastExpression() {
-  FilePos loc = m_tokenizer.getPos();
+  SourceLocation loc = getLocation();
   if (m_tokenizer.getCurrentType() != lex::Cast)
     return logError("expected cast expression");
   m_tokenizer.consume();
@@ -701,6 +1004,8 @@ Expression *Parser::buildCastExpression() {
   m_tokenizer.consume();
 
   Type *type = buildTypeQualification();
+  if (!type)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::GreaterSign) {
     return logError("expected >");
@@ -712,12 +1017,14 @@ Expression *Parser::buildCastExpression() {
   m_tokenizer.consume();
 
   Expression *expression = buildExpression();
+  if (!expression)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::RightParentheses)
     return logError("expected )");
   m_tokenizer.consume();
 
-  return new CastExpression(expression, type, loc);
+  return create<CastExpression>(expression, type, loc);
 }
 
 // trivial_expression :== <identifier> | <call_expression> |
@@ -726,11 +1033,11 @@ Expression *Parser::buildCastExpression() {
 //                             <ref_expression> | <string_literal> |
 //                             <cast_expression>
 Expression *Parser::buildTrivialExpression() {
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   // <integer_literal>
   if (m_tokenizer.getCurrentType() == lex::IntegerLiteral) {
     Expression *value =
-        new ConstantExpr(m_tokenizer.current().getIntegerLiteral(), locus);
+        create<ConstantExpr>(m_tokenizer.current().getIntegerLiteral(), locus);
     m_tokenizer.consume();
     return value;
   }
@@ -741,7 +1048,7 @@ Expression *Parser::buildTrivialExpression() {
   // FIXME: maybe we should move this into it's own function?
   if (m_tokenizer.getCurrentType() == lex::String) {
     StringLiteral *string_node =
-        new StringLiteral(m_tokenizer.current().getStringLiteral(), locus);
+        create<StringLiteral>(m_tokenizer.current().getStringLiteral(), locus);
     m_tokenizer.consume();
     return string_node;
   }
@@ -749,15 +1056,15 @@ Expression *Parser::buildTrivialExpression() {
   // <identifier>
   if (m_tokenizer.getCurrentType() == lex::Identifier) {
     // <identifier>  + '(' means call expr
-    if (m_tokenizer.peek().getType() == lex::LeftParentheses)
+    if (m_tokenizer.peekType() == lex::LeftParentheses)
       return buildCallExpr();
 
-    if (isFullstopOrLeftBracket(m_tokenizer.peek())) {
+    if (isFullstopOrLeftBracket(m_tokenizer.peekType())) {
       return buildPosfixExpression();
     }
 
     Expression *value =
-        new IdentifierExpr(m_tokenizer.current().getStringLiteral(), locus);
+        create<IdentifierExpr>(m_tokenizer.current().getSymbol(), locus);
     m_tokenizer.consume();
 
     return value;
@@ -767,6 +1074,8 @@ Expression *Parser::buildTrivialExpression() {
   if (m_tokenizer.getCurrentType() == lex::LeftParentheses) {
     m_tokenizer.consume(); // consume ; )
     Expression *value = buildExpression();
+    if (!value)
+      return nullptr;
 
     if (m_tokenizer.getCurrentType() != lex::RightParentheses) {
       logError("expected )");
@@ -783,17 +1092,17 @@ Expression *Parser::buildTrivialExpression() {
   if (m_tokenizer.getCurrentType() == lex::Deref)
     return buildDerefExpression();
 
-  return nullptr;
+  return logError("expected an expression");
 }
 
 // call_expressions :== <identifier>, '(', { <expression> ',' }+,  ')'
 Expression *Parser::buildCallExpr() {
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   if (m_tokenizer.getCurrentType() != lex::Identifier) {
     return logError("expected identfier");
   }
 
-  std::string function_name = m_tokenizer.current().getStringLiteral();
+  Symbol function_name = m_tokenizer.current().getSymbol();
 
   if (m_tokenizer.getNextType() != lex::LeftParentheses) {
     return logError("expected (");
@@ -805,6 +1114,8 @@ Expression *Parser::buildCallExpr() {
   // {<expression>, ','} +
   while (m_tokenizer.getCurrentType() != lex::RightParentheses) {
     Expression *expression = buildExpression();
+    if (!expression)
+      return nullptr;
     expressions.push_back(expression);
 
     // consume the comma
@@ -820,29 +1131,41 @@ Expression *Parser::buildCallExpr() {
   }
   m_tokenizer.consume();
 
-  return new CallExpr(function_name, expressions, locus);
+  if (m_callees)
+    m_callees->push_back(function_name);
+  return create<CallExpr>(function_name, expressions, locus);
 }
 
 ContextHolder Parser::getHolder() { return m_context; }
 
+SourceLocation Parser::getLocation() {
+  return m_context->sources.getLocation(m_file, m_tokenizer.getOffset());
+}
+
+SourceLocation Parser::getLocation(const lex::Token &token) {
+  return m_context->sources.getLocation(m_file, token.getOffset());
+}
+
 bool Parser::haveError() const { return m_context->diagnostics.hasError(); }
 
 // declaration_statement :== <type_qualification>, <identifier>, {'=',
 // <expression>} , ';'
 Statement *Parser::buildDeclarationStatement() {
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   Type *parsed_type = buildTypeQualification();
+  if (!parsed_type)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::Identifier)
     return logError("expected identifier");
 
-  std::string name = m_tokenizer.current().getStringLiteral();
+  Symbol name = m_tokenizer.current().getSymbol();
 
   //  we have this case
   // <type_qualification>, <identifier>, ';'
   if (m_tokenizer.getNextType() == lex::SemiColon) {
     m_tokenizer.consume(); // applying the side effect
-    return new DeclarationStatement(name, nullptr, parsed_type, locus);
+    return create<DeclarationStatement>(name, nullptr, parsed_type, locus);
   }
 
   if (m_tokenizer.getCurrentType() != lex::Equal)
@@ -850,17 +1173,19 @@ Statement *Parser::buildDeclarationStatement() {
   m_tokenizer.consume();
 
   Expression *expression = buildExpression();
+  if (!expression)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::SemiColon)
     return logError("expected ;");
   m_tokenizer.consume();
 
-  return new DeclarationStatement(name, expression, parsed_type, locus);
+  return create<DeclarationStatement>(name, expression, parsed_type, locus);
 }
 
 // deref_expression :== 'deref', '<', <trivial_expression>, '>'
 Expression *Parser::buildDerefExpression() {
-  FilePos locus = m_tokenizer.getPos();
+  SourceLocation locus = getLocation();
   if (m_tokenizer.getCurrentType() != lex::Deref) {
     return logError("expected deref");
   }
@@ -873,16 +1198,18 @@ Expression *Parser::buildDerefExpression() {
   m_tokenizer.consume();
 
   Expression *ref_get = buildTrivialExpression();
+  if (!ref_get)
+    return nullptr;
 
   if (m_tokenizer.getCurrentType() != lex::GreaterSign) {
     return logError("expected >");
   }
   m_tokenizer.consume();
 
-  LocatorExpression *deref_expression = new DeRefExpression(ref_get, locus);
+  LocatorExpression *deref_expression = create<DeRefExpression>(ref_get, locus);
   // FIXME: this is kind of a jank hack to get posfix expression to work
   // with deref expression
-  if (isFullstopOrLeftBracket(m_tokenizer.current())) {
+  if (isFullstopOrLeftBracket(m_tokenizer.getCurrentType())) {
     buildTailPosfixExpression(deref_expression);
     return deref_expression;
   }
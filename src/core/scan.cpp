@@ -0,0 +1,322 @@
+#include "core/scan.h"
+#include "core/lex.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VCC_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is not part of x86-64, it is compiled with a target attribute and only
+// used if the cpu reports it
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define VCC_SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace vcc;
+
+// ============================================================================
+// Scalar
+//
+static bool isWhiteSpace(char c) { return c == ' ' || c == '\n'; }
+
+static constexpr bool isTokenEnd(char c) {
+  return c == ' ' || c == '\n' || c == '\0' || lex::isOneCharacterToken(c);
+}
+
+static const char *skipWhiteSpaceScalar(const char *begin, const char *end) {
+  while (begin != end && isWhiteSpace(*begin))
+    ++begin;
+  return begin;
+}
+
+static const char *findNewLineScalar(const char *begin, const char *end) {
+  while (begin != end && *begin != '\n')
+    ++begin;
+  return begin;
+}
+
+static const char *findTokenEndScalar(const char *begin, const char *end) {
+  while (begin != end && !isTokenEnd(*begin))
+    ++begin;
+  return begin;
+}
+
+static bool isNotNewLine(char c) { return c != '\n'; }
+static bool isNotTokenEnd(char c) { return !isTokenEnd(c); }
+
+// Most runs in a source file are a single space or a short word, too short
+// for a vector load to pay off. The SIMD kernels look at the first ShortRun
+// characters one by one, and only then switch to the wide loop. Returns null
+// if all of them satisfy is_inside
+constexpr int ShortRun = 8;
+static inline const char *skipShortRun(const char *begin, const char *end,
+                                       bool (*is_inside)(char)) {
+  if (end - begin <= ShortRun) {
+    while (begin != end && is_inside(*begin))
+      ++begin;
+    return begin;
+  }
+
+  for (int i = 0; i < ShortRun; ++i) {
+    if (!is_inside(begin[i]))
+      return begin + i;
+  }
+  return nullptr;
+}
+
+// The SIMD kernels test for the token ending characters with two ranges and a
+// few single characters instead of a table lookup. Make sure they still agree
+// with the keyword table in lex.h
+static constexpr bool isTokenEndByRange(char c) {
+  unsigned char u = c;
+  return (u >= '(' && u <= '/') || (u >= ';' && u <= '>') || u == ' ' ||
+         u == '\n' || u == '\0' || u == '[' || u == ']' || u == '{' ||
+         u == '}';
+}
+
+static constexpr bool rangesMatchKeywordTable() {
+  for (int c = 0; c < 256; ++c) {
+    if (isTokenEnd(static_cast<char>(c)) !=
+        isTokenEndByRange(static_cast<char>(c)))
+      return false;
+  }
+  return true;
+}
+static_assert(rangesMatchKeywordTable(),
+              "one character tokens changed, update the SIMD kernels");
+
+// ============================================================================
+// SSE2
+//
+#ifdef VCC_SCAN_SSE2
+static inline __m128i equals16(__m128i chunk, char c) {
+  return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c));
+}
+
+// lo <= chunk <= hi, compared as unsigned
+static inline __m128i inRange16(__m128i chunk, char lo, char hi) {
+  __m128i shifted = _mm_sub_epi8(chunk, _mm_set1_epi8(lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(hi - lo)),
+                        shifted);
+}
+
+static inline unsigned whiteSpaceMask16(const char *at) {
+  __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(at));
+  return _mm_movemask_epi8(
+      _mm_or_si128(equals16(chunk, ' '), equals16(chunk, '\n')));
+}
+
+static inline unsigned newLineMask16(const char *at) {
+  __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(at));
+  return _mm_movemask_epi8(equals16(chunk, '\n'));
+}
+
+static inline unsigned tokenEndMask16(const char *at) {
+  __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(at));
+  __m128i mask = _mm_or_si128(inRange16(chunk, '(', '/'),
+                              inRange16(chunk, ';', '>'));
+  mask = _mm_or_si128(mask, equals16(chunk, ' '));
+  mask = _mm_or_si128(mask, equals16(chunk, '\n'));
+  mask = _mm_or_si128(mask, equals16(chunk, '\0'));
+  mask = _mm_or_si128(mask, equals16(chunk, '['));
+  mask = _mm_or_si128(mask, equals16(chunk, ']'));
+  mask = _mm_or_si128(mask, equals16(chunk, '{'));
+  mask = _mm_or_si128(mask, equals16(chunk, '}'));
+  return _mm_movemask_epi8(mask);
+}
+
+static const char *skipWhiteSpaceSSE2(const char *begin, const char *end) {
+  if (const char *at = skipShortRun(begin, end, isWhiteSpace))
+    return at;
+  begin += ShortRun;
+  for (; end - begin >= 16; begin += 16) {
+    unsigned mask = ~whiteSpaceMask16(begin) & 0xFFFF;
+    if (mask)
+      return begin + __builtin_ctz(mask);
+  }
+  return skipWhiteSpaceScalar(begin, end);
+}
+
+static const char *findNewLineSSE2(const char *begin, const char *end) {
+  if (const char *at = skipShortRun(begin, end, isNotNewLine))
+    return at;
+  begin += ShortRun;
+  for (; end - begin >= 16; begin += 16) {
+    if (unsigned mask = newLineMask16(begin))
+      return begin + __builtin_ctz(mask);
+  }
+  return findNewLineScalar(begin, end);
+}
+
+static const char *findTokenEndSSE2(const char *begin, const char *end) {
+  if (const char *at = skipShortRun(begin, end, isNotTokenEnd))
+    return at;
+  begin += ShortRun;
+  for (; end - begin >= 16; begin += 16) {
+    if (unsigned mask = tokenEndMask16(begin))
+      return begin + __builtin_ctz(mask);
+  }
+  return findTokenEndScalar(begin, end);
+}
+#endif
+
+// ============================================================================
+// AVX2
+//
+#ifdef VCC_SCAN_AVX2
+#define VCC_AVX2 __attribute__((target("avx2")))
+
+VCC_AVX2 static inline __m256i equals32(__m256i chunk, char c) {
+  return _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(c));
+}
+
+// lo <= chunk <= hi, compared as unsigned
+VCC_AVX2 static inline __m256i inRange32(__m256i chunk, char lo, char hi) {
+  __m256i shifted = _mm256_sub_epi8(chunk, _mm256_set1_epi8(lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(hi - lo)),
+                           shifted);
+}
+
+VCC_AVX2 static inline unsigned whiteSpaceMask32(const char *at) {
+  __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at));
+  return _mm256_movemask_epi8(
+      _mm256_or_si256(equals32(chunk, ' '), equals32(chunk, '\n')));
+}
+
+VCC_AVX2 static inline unsigned newLineMask32(const char *at) {
+  __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at));
+  return _mm256_movemask_epi8(equals32(chunk, '\n'));
+}
+
+VCC_AVX2 static inline unsigned tokenEndMask32(const char *at) {
+  __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at));
+  __m256i mask = _mm256_or_si256(inRange32(chunk, '(', '/'),
+                                 inRange32(chunk, ';', '>'));
+  mask = _mm256_or_si256(mask, equals32(chunk, ' '));
+  mask = _mm256_or_si256(mask, equals32(chunk, '\n'));
+  mask = _mm256_or_si256(mask, equals32(chunk, '\0'));
+  mask = _mm256_or_si256(mask, equals32(chunk, '['));
+  mask = _mm256_or_si256(mask, equals32(chunk, ']'));
+  mask = _mm256_or_si256(mask, equals32(chunk, '{'));
+  mask = _mm256_or_si256(mask, equals32(chunk, '}'));
+  return _mm256_movemask_epi8(mask);
+}
+
+VCC_AVX2 static const char *skipWhiteSpaceAVX2(const char *begin,
+                                               const char *end) {
+  if (const char *at = skipShortRun(begin, end, isWhiteSpace))
+    return at;
+  begin += ShortRun;
+  for (; end - begin >= 32; begin += 32) {
+    unsigned mask = ~whiteSpaceMask32(begin);
+    if (mask)
+      return begin + __builtin_ctz(mask);
+  }
+  return skipWhiteSpaceSSE2(begin, end);
+}
+
+VCC_AVX2 static const char *findNewLineAVX2(const char *begin,
+                                            const char *end) {
+  if (const char *at = skipShortRun(begin, end, isNotNewLine))
+    return at;
+  begin += ShortRun;
+  for (; end - begin >= 32; begin += 32) {
+    if (unsigned mask = newLineMask32(begin))
+      return begin + __builtin_ctz(mask);
+  }
+  return findNewLineSSE2(begin, end);
+}
+
+VCC_AVX2 static const char *findTokenEndAVX2(const char *begin,
+                                             const char *end) {
+  if (const char *at = skipShortRun(begin, end, isNotTokenEnd))
+    return at;
+  begin += ShortRun;
+  for (; end - begin >= 32; begin += 32) {
+    if (unsigned mask = tokenEndMask32(begin))
+      return begin + __builtin_ctz(mask);
+  }
+  return findTokenEndSSE2(begin, end);
+}
+#endif
+
+// ============================================================================
+// Dispatch
+//
+using scan::KernelTable;
+
+static const KernelTable *getTable(scan::Kernel kernel) {
+  static const KernelTable scalar = {skipWhiteSpaceScalar, findNewLineScalar,
+                                     findTokenEndScalar};
+#ifdef VCC_SCAN_SSE2
+  static const KernelTable sse2 = {skipWhiteSpaceSSE2, findNewLineSSE2,
+                                   findTokenEndSSE2};
+#endif
+#ifdef VCC_SCAN_AVX2
+  static const KernelTable avx2 = {skipWhiteSpaceAVX2, findNewLineAVX2,
+                                   findTokenEndAVX2};
+#endif
+
+  switch (kernel) {
+#ifdef VCC_SCAN_AVX2
+  case scan::AVX2:
+    return &avx2;
+#endif
+#ifdef VCC_SCAN_SSE2
+  case scan::SSE2:
+    return &sse2;
+#endif
+  default:
+    return &scalar;
+  }
+}
+
+scan::Kernel scan::getBestKernel() {
+#ifdef VCC_SCAN_AVX2
+  if (__builtin_cpu_supports("avx2"))
+    return AVX2;
+#endif
+#ifdef VCC_SCAN_SSE2
+  return SSE2;
+#else
+  return Scalar;
+#endif
+}
+
+// the kernel can be switched while other threads are lexing, they pick up
+// either table, both give the same results
+static std::atomic<scan::Kernel> current_kernel = scan::getBestKernel();
+static std::atomic<const KernelTable *> current_table =
+    getTable(current_kernel);
+
+static const KernelTable *getCurrentTable() {
+  return current_table.load(std::memory_order_relaxed);
+}
+
+scan::Kernel scan::getKernel() { return current_kernel; }
+
+bool scan::setKernel(Kernel kernel) {
+  if (kernel > getBestKernel())
+    return false;
+
+  current_kernel = kernel;
+  current_table = getTable(kernel);
+  return true;
+}
+
+const KernelTable &scan::getKernelTable() { return *getCurrentTable(); }
+
+const char *scan::skipWhiteSpace(const char *begin, const char *end) {
+  return getCurrentTable()->skip_white_space(begin, end);
+}
+
+const char *scan::findNewLine(const char *begin, const char *end) {
+  return getCurrentTable()->find_new_line(begin, end);
+}
+
+const char *scan::findTokenEnd(const char *begin, const char *end) {
+  return getCurrentTable()->find_token_end(begin, end);
+}
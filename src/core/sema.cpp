@@ -1,10 +1,578 @@
 #include "core/sema.h"
 #include "core/util.h"
+#include <algorithm>
 #include <iostream>
+#include <llvm/ADT/APSInt.h>
 #include <memory>
 
 using namespace vcc;
 
 Sema::Sema() {}
 
-bool Sema::checkFunction(FunctionDecl *function_decl) { return true; }
+bool Sema::analyze(ContextHolder holder,
+                   const std::vector<Statement *> &syntax_tree) {
+  m_context = holder;
+  unsigned error_count = m_context->diagnostics.getErrorCount();
+  for (Statement *statement : syntax_tree) {
+    checkFunction(dyncast<FunctionDecl>(statement));
+    if (m_context->diagnostics.reachedErrorLimit())
+      break;
+  }
+  return m_context->diagnostics.getErrorCount() == error_count;
+}
+
+bool Sema::checkFunction(FunctionDecl *function_decl) {
+  unsigned error_count = m_context->diagnostics.getErrorCount();
+  Symbol name = function_decl->getName();
+  if (m_functions.find(name) != m_functions.end()) {
+    diag(function_decl, "redefinition of function");
+    return false;
+  }
+  // before the body, a function can call itself
+  m_functions[name] = function_decl;
+  // the errors of an invalid body were reported by the parser
+  if (function_decl->isExtern() || function_decl->isInvalid())
+    return true;
+
+  pushScope();
+  for (TypeInfo &arg : function_decl->getArgList()->getArgs())
+    declare(function_decl, &arg);
+  checkStatements(function_decl->getStatements());
+  popScope();
+  return m_context->diagnostics.getErrorCount() == error_count;
+}
+
+void Sema::checkStatements(const std::vector<Statement *> &statements) {
+  for (Statement *statement : statements) {
+    checkStatement(statement);
+    if (m_context->diagnostics.reachedErrorLimit())
+      return;
+  }
+}
+
+void Sema::checkStatement(Statement *statement) {
+  switch (statement->getCode()) {
+  case code::DeclarationStatement: {
+    DeclarationStatement *declaration =
+        dyncast<DeclarationStatement>(statement);
+    if (Expression *expression = declaration->getExpression()) {
+      Type *type = checkExpression(expression);
+      if (type && !Type::isSame(declaration->getType(), type))
+        diag(declaration, "type mismatch");
+    }
+    declare(declaration, declaration->getVariable());
+    return;
+  }
+  case code::AssignmentStatement: {
+    AssignmentStatement *assignment = dyncast<AssignmentStatement>(statement);
+    Type *type = checkExpression(assignment->getExpression());
+    Type *ref_type = checkExpression(assignment->getRefExpression());
+    if (!isa<LocatorExpression>(assignment->getRefExpression()))
+      diag(assignment, "expression is not assignable");
+    else if (type && ref_type && !Type::isSame(type, ref_type))
+      diag(assignment, "invalid type");
+    return;
+  }
+  case code::ReturnStatement:
+    if (Expression *expression =
+            dyncast<ReturnStatement>(statement)->getExpression())
+      checkExpression(expression);
+    return;
+  case code::CallStatement:
+    checkExpression(dyncast<CallStatement>(statement)->getCallExpression());
+    return;
+  case code::IfStatement: {
+    IfStatement *if_statement = dyncast<IfStatement>(statement);
+    checkCondition(if_statement->getCondition());
+    pushScope();
+    checkStatements(if_statement->getStatements());
+    popScope();
+    return;
+  }
+  case code::WhileStatement: {
+    WhileStatement *while_statement = dyncast<WhileStatement>(statement);
+    checkCondition(while_statement->getCondition());
+    pushScope();
+    checkStatements(while_statement->getStatements());
+    popScope();
+    return;
+  }
+  default:
+    assert(false && "not a statement of a function body");
+  }
+}
+
+void Sema::checkCondition(Expression *condition) {
+  Type *type = checkExpression(condition);
+  if (!type)
+    return;
+
+  // the branch compares the condition with an integer zero
+  if (!type->isBuiltin() || !type->getAs<BuiltinType>()->isIntegerKind())
+    diag(condition, "condition must be an integer");
+}
+
+Type *Sema::checkExpression(Expression *expression) {
+  Type *type = computeType(expression);
+  expression->setType(type);
+  if (type)
+    fold(expression);
+  return type;
+}
+
+Type *Sema::computeType(Expression *expression) {
+  TypeContext &types = *m_context->types;
+  switch (expression->getCode()) {
+  case code::ConstantExpr:
+    return types.getBuiltinType(BuiltinType::Int);
+  case code::StringLiteral:
+    return types.getPointerType(types.getBuiltinType(BuiltinType::Char));
+  case code::IdentifierExpr: {
+    IdentifierExpr *identifier = dyncast<IdentifierExpr>(expression);
+    TypeInfo *variable = lookup(identifier, identifier->getName());
+    identifier->setVariable(variable);
+    return variable ? variable->type : nullptr;
+  }
+  case code::BinaryExpression:
+    return checkBinaryExpression(dyncast<BinaryExpression>(expression));
+  case code::CallExpr:
+    return checkCallExpr(dyncast<CallExpr>(expression));
+  case code::CastExpression: {
+    CastExpression *cast = dyncast<CastExpression>(expression);
+    Type *from = checkExpression(cast->getExpression());
+    if (!from)
+      return nullptr;
+    if (!CastExpression::canCast(from, cast->getCastTo())) {
+      diag(cast, "cannot perform a cast");
+      return nullptr;
+    }
+    return cast->getCastTo();
+  }
+  case code::RefExpression: {
+    Expression *inner = dyncast<RefExpression>(expression)->getInnerExpression();
+    Type *type = checkExpression(inner);
+    if (!type)
+      return nullptr;
+    if (!isa<LocatorExpression>(inner)) {
+      diag(expression, "cannot take the reference of this expression");
+      return nullptr;
+    }
+    return types.getPointerType(type);
+  }
+  case code::DeRefExpression:
+    return checkDeRef(dyncast<DeRefExpression>(expression));
+  case code::MemberAccessExpression:
+    return checkMemberAccess(dyncast<MemberAccessExpression>(expression));
+  case code::ArrayAccessExpression:
+    return checkArrayAccess(dyncast<ArrayAccessExpression>(expression));
+  default:
+    assert(false && "you have missed a case");
+    return nullptr;
+  }
+}
+
+static Type *getIntWithMoreBits(BuiltinType *lhs, BuiltinType *rhs) {
+  assert(lhs->isIntegerKind() && rhs->isIntegerKind());
+  return lhs->getBitSize() > rhs->getBitSize() ? lhs : rhs;
+}
+
+Type *Sema::checkBinaryExpression(BinaryExpression *expression) {
+  Type *lhs = checkExpression(expression->getLHS());
+  Type *rhs = checkExpression(expression->getRHS());
+  if (!lhs || !rhs)
+    return nullptr;
+
+  // pointer arithmetic is ill formed for now
+  if (!lhs->isBuiltin() || !rhs->isBuiltin()) {
+    diag(expression, "invalid operands to binary expression");
+    return nullptr;
+  }
+
+  // if it is from a boolean expression, it should always return a boolean
+  // expression regardless of the two types
+  if (expression->isComparison())
+    return m_context->types->getBuiltinType(BuiltinType::Bool);
+
+  // return float type if either the left hand side or the right hand side
+  // have a floating point
+  BuiltinType *casted_lhs = lhs->getAs<BuiltinType>();
+  BuiltinType *casted_rhs = rhs->getAs<BuiltinType>();
+  if (casted_lhs->isFloat())
+    return casted_lhs;
+  if (casted_rhs->isFloat())
+    return casted_rhs;
+
+  return getIntWithMoreBits(casted_lhs, casted_rhs);
+}
+
+Type *Sema::checkCallExpr(CallExpr *expression) {
+  bool arguments_valid = true;
+  for (Expression *argument : expression->getArguments())
+    arguments_valid &= checkExpression(argument) != nullptr;
+
+  auto it = m_functions.find(expression->getName());
+  if (it == m_functions.end()) {
+    diag(expression, "undefined function");
+    return nullptr;
+  }
+  FunctionDecl *function_decl = it->second;
+  expression->setFunctionDecl(function_decl);
+  if (!arguments_valid)
+    return function_decl->getReturnType();
+
+  const std::vector<Expression *> &arguments = expression->getArguments();
+  const std::vector<TypeInfo> &args = function_decl->getArgList()->getArgs();
+  if (args.size() != arguments.size()) {
+    diag(expression, "number of argument mismatch");
+    return function_decl->getReturnType();
+  }
+
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    if (!Type::isSame(args[i].type, arguments[i]->getType())) {
+      diag(expression, "type mismatch");
+      break;
+    }
+  }
+  return function_decl->getReturnType();
+}
+
+Type *Sema::getPosfixBaseType(LocatorExpression *parent) {
+  if (MemberAccessExpression *member =
+          dyncast<MemberAccessExpression>(parent))
+    return member->getGEPType() ? member->getGEPChildType() : nullptr;
+
+  if (ArrayAccessExpression *array = dyncast<ArrayAccessExpression>(parent))
+    return array->getGEPType() ? array->getGEPChildType() : nullptr;
+
+  // the dereference is not the expression that was checked, its posfix child
+  // is
+  DeRefExpression *deref = dyncast<DeRefExpression>(parent);
+  Expression *pointer = deref->getPointerExpression();
+  Type *type = pointer->getType() ? pointer->getType() : checkExpression(pointer);
+  if (!type)
+    return nullptr;
+  if (!type->isPointer()) {
+    diag(deref, "dereference of a non pointer");
+    return nullptr;
+  }
+  return deref->getInnerType();
+}
+
+Type *Sema::checkMemberAccess(MemberAccessExpression *expression) {
+  Type *type = nullptr;
+  if (LocatorExpression *parent = expression->getParentExpression()) {
+    type = getPosfixBaseType(parent);
+  } else if (TypeInfo *variable =
+                 lookup(expression, expression->getBaseName())) {
+    expression->setVariable(variable);
+    type = variable->type;
+  }
+  if (!type)
+    return nullptr;
+
+  StructType *struct_type = dyncast<StructType>(type);
+  if (!struct_type) {
+    diag(expression, "member access into a non struct");
+    return nullptr;
+  }
+  if (!struct_type->hasElement(expression->getMember())) {
+    diag(expression, "no member named " + expression->getMember().str());
+    return nullptr;
+  }
+  expression->setGEPType(struct_type);
+
+  if (LocatorExpression *child = expression->getChildPosfixExpression())
+    return checkExpression(child);
+  return expression->getGEPChildType();
+}
+
+Type *Sema::checkArrayAccess(ArrayAccessExpression *expression) {
+  Type *type = nullptr;
+  if (LocatorExpression *parent = expression->getParentExpression()) {
+    // this is the element type of the parent, see getGEPChildType
+    type = getPosfixBaseType(parent);
+  } else if (TypeInfo *variable =
+                 lookup(expression, expression->getBaseName())) {
+    expression->setVariable(variable);
+    type = variable->type;
+    // a pointer is indexed through its pointee
+    if (PointerType *pointer = dyncast<PointerType>(type)) {
+      type = pointer->getPointee();
+    } else if (!type->isArray()) {
+      diag(expression, "subscripted value is not an array or pointer");
+      return nullptr;
+    }
+  }
+
+  Type *index = checkExpression(expression->getIndexExpression());
+  if (!type || !index)
+    return nullptr;
+  if (!index->isBuiltin() || !index->getAs<BuiltinType>()->isIntegerKind()) {
+    diag(expression->getIndexExpression(), "array index is not an integer");
+    return nullptr;
+  }
+  expression->setGEPType(type);
+
+  if (LocatorExpression *child = expression->getChildPosfixExpression())
+    return checkExpression(child);
+  return expression->getGEPChildType();
+}
+
+Type *Sema::checkDeRef(DeRefExpression *expression) {
+  Type *type = checkExpression(expression->getPointerExpression());
+  if (!type)
+    return nullptr;
+  if (!type->isPointer()) {
+    diag(expression, "dereference of a non pointer");
+    return nullptr;
+  }
+
+  if (LocatorExpression *child = expression->getPosfixChildExpression())
+    return checkExpression(child);
+  return expression->getInnerType();
+}
+
+// ======================================================
+// ====================== FOLDING =======================
+// The constants follow what code generation would have emitted for the
+// expression, bit for bit. Whatever the IR leaves undefined, such as a
+// division by zero, is not folded and stays for code generation.
+static ConstantValue fromBool(bool value) {
+  return ConstantValue(llvm::APInt(1, value));
+}
+
+/// see the SIToFP of BinaryExpression::getVal and of builtinCast
+static llvm::APFloat toFloat(const ConstantValue &value) {
+  if (value.isFloat())
+    return value.getFloat();
+  llvm::APFloat result(llvm::APFloat::IEEEsingle());
+  result.convertFromAPInt(value.getInteger(), /*IsSigned=*/true,
+                          llvm::APFloat::rmNearestTiesToEven);
+  return result;
+}
+
+/// see BinaryExpression::handleInteger
+static std::optional<ConstantValue>
+foldInteger(BinaryExpression::BinaryExpressionType kind, llvm::APInt lhs,
+            llvm::APInt rhs) {
+  // the narrower side is sign extended, a bool too
+  unsigned width = std::max(lhs.getBitWidth(), rhs.getBitWidth());
+  lhs = lhs.sext(width);
+  rhs = rhs.sext(width);
+
+  switch (kind) {
+  case BinaryExpression::Add:
+    return ConstantValue(lhs + rhs);
+  case BinaryExpression::Subtract:
+    return ConstantValue(lhs - rhs);
+  case BinaryExpression::Multiply:
+    return ConstantValue(lhs * rhs);
+  case BinaryExpression::Divide:
+    if (rhs.isZero())
+      return std::nullopt;
+    return ConstantValue(lhs.udiv(rhs));
+  case BinaryExpression::Equal:
+    return fromBool(lhs == rhs);
+  case BinaryExpression::NEquals:
+    return fromBool(lhs != rhs);
+  case BinaryExpression::GE:
+    return fromBool(lhs.sge(rhs));
+  case BinaryExpression::GT:
+    return fromBool(lhs.sgt(rhs));
+  case BinaryExpression::LE:
+    return fromBool(lhs.sle(rhs));
+  case BinaryExpression::LT:
+    return fromBool(lhs.slt(rhs));
+  }
+  return std::nullopt;
+}
+
+/// see the floating point half of BinaryExpression::getVal, the comparisons
+/// are ordered ones
+static std::optional<ConstantValue>
+foldFloat(BinaryExpression::BinaryExpressionType kind, llvm::APFloat lhs,
+          const llvm::APFloat &rhs) {
+  llvm::APFloat::roundingMode rounding = llvm::APFloat::rmNearestTiesToEven;
+  llvm::APFloat::cmpResult order = lhs.compare(rhs);
+  switch (kind) {
+  case BinaryExpression::Add:
+    lhs.add(rhs, rounding);
+    return ConstantValue(lhs);
+  case BinaryExpression::Subtract:
+    lhs.subtract(rhs, rounding);
+    return ConstantValue(lhs);
+  case BinaryExpression::Multiply:
+    lhs.multiply(rhs, rounding);
+    return ConstantValue(lhs);
+  case BinaryExpression::Divide:
+    lhs.divide(rhs, rounding);
+    return ConstantValue(lhs);
+  case BinaryExpression::Equal:
+    return fromBool(order == llvm::APFloat::cmpEqual);
+  case BinaryExpression::NEquals:
+    return fromBool(order == llvm::APFloat::cmpLessThan ||
+                    order == llvm::APFloat::cmpGreaterThan);
+  case BinaryExpression::GE:
+    return fromBool(order == llvm::APFloat::cmpGreaterThan ||
+                    order == llvm::APFloat::cmpEqual);
+  case BinaryExpression::GT:
+    return fromBool(order == llvm::APFloat::cmpGreaterThan);
+  case BinaryExpression::LE:
+    return fromBool(order == llvm::APFloat::cmpLessThan ||
+                    order == llvm::APFloat::cmpEqual);
+  case BinaryExpression::LT:
+    return fromBool(order == llvm::APFloat::cmpLessThan);
+  }
+  return std::nullopt;
+}
+
+/// see CastExpression::builtinCast
+static std::optional<ConstantValue> castConstant(const ConstantValue &value,
+                                                 BuiltinType *from,
+                                                 BuiltinType *to) {
+  if (from->isIntegerKind() && to->isFloat())
+    return ConstantValue(toFloat(value));
+
+  unsigned width = to->getBitSize();
+  if (from->isFloat() && to->isIntegerKind()) {
+    // a float that does not fit is poison
+    llvm::APSInt result(width, /*isUnsigned=*/false);
+    bool is_exact;
+    if (value.getFloat().convertToInteger(result, llvm::APFloat::rmTowardZero,
+                                          &is_exact) ==
+        llvm::APFloat::opInvalidOp)
+      return std::nullopt;
+    return ConstantValue(llvm::APInt(result));
+  }
+
+  // a bool is zero extended
+  if (from->isBool())
+    return ConstantValue(value.getInteger().zext(width));
+  return ConstantValue(value.getInteger().sextOrTrunc(width));
+}
+
+/// true if constant is the integer value, once sign extended
+static bool isInteger(const std::optional<ConstantValue> &constant,
+                      int64_t value) {
+  return constant && !constant->isFloat() &&
+         constant->getInteger().getSExtValue() == value;
+}
+
+void Sema::fold(Expression *expression) {
+  if (BinaryExpression *binary = dyncast<BinaryExpression>(expression))
+    foldBinaryExpression(binary);
+  else if (CastExpression *cast = dyncast<CastExpression>(expression))
+    foldCast(cast);
+}
+
+/// a literal is not given a ConstantValue, most of them are not an operand of
+/// anything that folds. Their value is read here instead
+static std::optional<ConstantValue> getOperandValue(Expression *operand) {
+  if (ConstantExpr *literal = dyncast<ConstantExpr>(operand))
+    return ConstantValue(
+        llvm::APInt(32, literal->getValue(), /*isSigned=*/true));
+  if (const ConstantValue *constant = operand->getConstant())
+    return *constant;
+  return std::nullopt;
+}
+
+void Sema::foldBinaryExpression(BinaryExpression *expression) {
+  Expression *lhs = expression->getLHS();
+  Expression *rhs = expression->getRHS();
+  std::optional<ConstantValue> lhs_value = getOperandValue(lhs);
+  std::optional<ConstantValue> rhs_value = getOperandValue(rhs);
+  if (lhs_value && rhs_value) {
+    if (lhs_value->isFloat() || rhs_value->isFloat())
+      expression->setConstant(createConstant(foldFloat(
+          expression->getKind(), toFloat(*lhs_value), toFloat(*rhs_value))));
+    else
+      expression->setConstant(createConstant(
+          foldInteger(expression->getKind(), lhs_value->getInteger(),
+                      rhs_value->getInteger())));
+    return;
+  }
+
+  // x + 0 is not x for a float x of -0.0, only integers are simplified
+  BuiltinType *type = expression->getType()->getAs<BuiltinType>();
+  if (!type->isIntegerKind())
+    return;
+
+  Expression *simplified = nullptr;
+  switch (expression->getKind()) {
+  case BinaryExpression::Add:
+    if (isInteger(rhs_value, 0))
+      simplified = lhs;
+    else if (isInteger(lhs_value, 0))
+      simplified = rhs;
+    break;
+  case BinaryExpression::Subtract:
+    if (isInteger(rhs_value, 0))
+      simplified = lhs;
+    break;
+  case BinaryExpression::Multiply:
+    if (isInteger(rhs_value, 1))
+      simplified = lhs;
+    else if (isInteger(lhs_value, 1))
+      simplified = rhs;
+    break;
+  case BinaryExpression::Divide:
+    if (isInteger(rhs_value, 1))
+      simplified = lhs;
+    break;
+  default:
+    break;
+  }
+
+  // the operand must not need the extension to the type of the result
+  if (simplified && Type::isSame(simplified->getType(), type))
+    expression->setSimplified(simplified);
+}
+
+void Sema::foldCast(CastExpression *expression) {
+  Expression *inner = expression->getExpression();
+  Type *from = inner->getType();
+  Type *to = expression->getCastTo();
+  if (!from->isBuiltin() || !to->isBuiltin())
+    return;
+  std::optional<ConstantValue> value = getOperandValue(inner);
+  if (!value)
+    return;
+
+  if (Type::isSame(from, to)) {
+    expression->setConstant(createConstant(value));
+    return;
+  }
+  expression->setConstant(createConstant(castConstant(
+      *value, from->getAs<BuiltinType>(), to->getAs<BuiltinType>())));
+}
+
+const ConstantValue *
+Sema::createConstant(std::optional<ConstantValue> value) {
+  if (!value)
+    return nullptr;
+  return m_context->ast.create<ConstantValue>(std::move(*value));
+}
+
+void Sema::pushScope() { m_scopes.emplace_back(); }
+
+void Sema::popScope() { m_scopes.pop_back(); }
+
+void Sema::declare(const ASTBase *at, TypeInfo *variable) {
+  if (!m_scopes.back().emplace(variable->name, variable).second)
+    diag(at, "redefinition of " + variable->name.str());
+}
+
+TypeInfo *Sema::lookup(const ASTBase *at, Symbol name) {
+  for (auto scope = m_scopes.rbegin(); scope != m_scopes.rend(); ++scope) {
+    auto it = scope->find(name);
+    if (it != scope->end())
+      return it->second;
+  }
+
+  diag(at, "undefined variable " + name.str());
+  return nullptr;
+}
+
+void Sema::diag(const ASTBase *at, const std::string &message) {
+  m_context->diagnostics.diag(at, message);
+}
@@ -0,0 +1,99 @@
+#include "core/source.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace vcc;
+
+SourceLocation SourceLocation::fromRaw(std::uint32_t raw) {
+  SourceLocation loc;
+  loc.m_raw = raw;
+  return loc;
+}
+
+std::uint32_t SourceLocation::getRaw() const { return m_raw; }
+
+bool SourceLocation::isValid() const { return m_raw != 0; }
+
+SourceLocation SourceLocation::getLocWithOffset(long offset) const {
+  assert(isValid() && "cannot move an invalid location");
+  return fromRaw(m_raw + offset);
+}
+
+bool SourceLocation::operator==(SourceLocation other) const {
+  return m_raw == other.m_raw;
+}
+
+bool SourceLocation::operator!=(SourceLocation other) const {
+  return m_raw != other.m_raw;
+}
+
+bool SourceLocation::operator<(SourceLocation other) const {
+  return m_raw < other.m_raw;
+}
+
+SourceManager::FileID SourceManager::addFile(const char *filename,
+                                             FileStream::Backend backend) {
+  return addStream(std::make_unique<FileStream>(filename, backend));
+}
+
+SourceManager::FileID SourceManager::addBuffer(std::string_view content,
+                                               std::string name) {
+  return addStream(std::make_unique<FileStream>(content, std::move(name)));
+}
+
+SourceManager::FileID
+SourceManager::addStream(std::unique_ptr<FileStream> stream) {
+  assert(m_next_start <= UINT32_MAX &&
+         "a source of unknown size must be added last");
+
+  std::uint32_t start = m_next_start;
+  // one more than the size, so that the end of file has a location too
+  if (stream->getBackend() == FileStream::Buffered)
+    m_next_start += stream->getSize() + 1;
+  else
+    m_next_start = std::uint64_t(UINT32_MAX) + 1;
+  assert(m_next_start <= std::uint64_t(UINT32_MAX) + 1 &&
+         "the sources are too large");
+
+  m_entries.push_back({start, std::move(stream)});
+  return m_entries.size() - 1;
+}
+
+FileStream &SourceManager::getStream(FileID id) {
+  assert(0 <= id && id < getFileCount() && "invalid file id");
+  return *m_entries[id].stream;
+}
+
+int SourceManager::getFileCount() const { return m_entries.size(); }
+
+SourceLocation SourceManager::getLocation(FileID id, long offset) const {
+  assert(0 <= id && id < getFileCount() && "invalid file id");
+  return SourceLocation::fromRaw(m_entries[id].start + offset);
+}
+
+SourceManager::FileID SourceManager::getFileID(SourceLocation loc) const {
+  assert(loc.isValid() && "the invalid location is in no file");
+  // the last source that starts at or before loc
+  auto it = std::upper_bound(
+      m_entries.begin(), m_entries.end(), loc.getRaw(),
+      [](std::uint32_t raw, const Entry &entry) { return raw < entry.start; });
+  assert(it != m_entries.begin() && "location is before every source");
+  return (it - m_entries.begin()) - 1;
+}
+
+long SourceManager::getFileOffset(SourceLocation loc) const {
+  return loc.getRaw() - m_entries[getFileID(loc)].start;
+}
+
+FilePos SourceManager::getPos(SourceLocation loc) {
+  return getStream(getFileID(loc)).getPos(getFileOffset(loc));
+}
+
+std::string SourceManager::getLine(SourceLocation loc) {
+  return getStream(getFileID(loc)).getLine(getFileOffset(loc));
+}
+
+const std::string &SourceManager::getName(SourceLocation loc) const {
+  return m_entries[getFileID(loc)].stream->getName();
+}
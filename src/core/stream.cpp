@@ -1,25 +1,211 @@
 #include "core/stream.h"
+#include "core/scan.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace vcc;
 
-FileStream::FileStream(const char *filename) {
-  m_file = std::fopen(filename, "rb");
-  m_open = true;
+// stdin, pipes and devices can neither be mapped nor rewound
+static bool isStream(const char *filename) {
+  if (std::string_view(filename) == "-")
+    return true;
 
-  if (!m_file)
-    m_open = false;
+#ifndef _WIN32
+  struct stat info;
+  return stat(filename, &info) == 0 && !S_ISREG(info.st_mode);
+#else
+  return false;
+#endif
+}
+
+FileStream::FileStream(const char *filename, Backend backend)
+    : m_backend(isStream(filename) ? Streamed : backend), m_name(filename) {
+  switch (m_backend) {
+  case Buffered:
+    openBuffer(filename);
+    break;
+  case Stdio:
+    m_file = std::fopen(filename, "rb");
+    m_open = m_file != nullptr;
+    m_line_starts.push_back(0);
+    break;
+  case Streamed:
+    openStream(filename);
+    break;
+  }
 
+  // the caller reports the error, until then the stream is an empty file
   if (!is_open()) {
-    std::cerr << "cannot open file:" << filename << "\n";
-    std::exit(-1);
+    m_backend = Buffered;
+    useStorage();
+    m_open = false;
   }
 }
 
+FileStream::FileStream(std::string_view content, std::string name)
+    : m_backend(Buffered), m_name(std::move(name)),
+      m_storage(content.begin(), content.end()) {
+  useStorage();
+}
+
+FileStream::~FileStream() {
+#ifndef _WIN32
+  if (m_mapping)
+    munmap(m_mapping, m_mapping_size);
+#endif
+
+  if (m_file && m_file != stdin)
+    std::fclose(m_file);
+}
+
+void FileStream::openBuffer(const char *filename) {
+  m_open = false;
+
+#ifndef _WIN32
+  int fd = ::open(filename, O_RDONLY);
+  if (fd < 0)
+    return;
+
+  // regular files are mapped, everything else (pipes, character devices, etc)
+  // is read until there is nothing left
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void *mapping =
+        mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, /*offset*/ 0);
+    if (mapping != MAP_FAILED) {
+      m_mapping = mapping;
+      m_mapping_size = info.st_size;
+    }
+  }
+
+  if (!m_mapping) {
+    char chunk[4096];
+    ssize_t count;
+    while ((count = ::read(fd, chunk, sizeof(chunk))) > 0)
+      m_storage.insert(m_storage.end(), chunk, chunk + count);
+
+    if (count < 0) {
+      ::close(fd);
+      return;
+    }
+  }
+  ::close(fd);
+#else
+  std::FILE *file = std::fopen(filename, "rb");
+  if (!file)
+    return;
+
+  char chunk[4096];
+  std::size_t count;
+  while ((count = std::fread(chunk, sizeof(char), sizeof(chunk), file)) > 0)
+    m_storage.insert(m_storage.end(), chunk, chunk + count);
+  std::fclose(file);
+#endif
+
+  if (!m_mapping) {
+    useStorage();
+    return;
+  }
+
+  m_begin = static_cast<const char *>(m_mapping);
+  m_end = m_begin + m_mapping_size;
+  m_current = m_begin;
+  m_open = true;
+  buildLineTable();
+}
+
+void FileStream::useStorage() {
+  // the scan kernels tell a null result apart from a position, so an empty
+  // file still gets a valid pointer
+  static const char empty = 0;
+  m_begin = m_storage.empty() ? &empty : m_storage.data();
+  m_end = m_begin + m_storage.size();
+  m_current = m_begin;
+  m_open = true;
+  m_line_starts.clear();
+  buildLineTable();
+}
+
+void FileStream::buildLineTable() {
+  m_line_starts.push_back(0);
+  auto find_new_line = scan::getKernelTable().find_new_line;
+  for (const char *at = find_new_line(m_begin, m_end); at != m_end;
+       at = find_new_line(at + 1, m_end))
+    m_line_starts.push_back(at - m_begin + 1);
+}
+
+void FileStream::openStream(const char *filename) {
+  m_file =
+      std::string_view(filename) == "-" ? stdin : std::fopen(filename, "rb");
+  m_open = m_file != nullptr;
+  m_line_starts.push_back(0);
+}
+
+bool FileStream::readChunk(long keep_from) {
+  if (m_is_stream_done)
+    return false;
+
+  long drop_until = std::min(keep_from, m_stream_pos - BacktrackWindow);
+  if (drop_until > m_window_offset) {
+    m_storage.erase(m_storage.begin(),
+                    m_storage.begin() + (drop_until - m_window_offset));
+    m_window_offset = drop_until;
+  }
+
+  std::size_t old_size = m_storage.size();
+  m_storage.resize(old_size + ChunkSize);
+  std::size_t count =
+      std::fread(m_storage.data() + old_size, sizeof(char), ChunkSize, m_file);
+  m_storage.resize(old_size + count);
+  if (count == 0) {
+    m_is_stream_done = true;
+    return false;
+  }
+
+  // the lines that start in the new chunk
+  const char *chunk = m_storage.data() + old_size;
+  const char *chunk_end = chunk + count;
+  long chunk_offset = m_window_offset + old_size;
+  auto find_new_line = scan::getKernelTable().find_new_line;
+  for (const char *at = find_new_line(chunk, chunk_end); at != chunk_end;
+       at = find_new_line(at + 1, chunk_end))
+    m_line_starts.push_back(chunk_offset + (at - chunk) + 1);
+  return true;
+}
+
 char FileStream::get() {
+  if (m_backend == Streamed) {
+    m_is_end_of_file = false;
+    if (m_stream_pos == m_window_offset + static_cast<long>(m_storage.size()) &&
+        !readChunk(m_stream_pos)) {
+      m_is_end_of_file = true;
+      return 0;
+    }
+
+    return m_storage[m_stream_pos++ - m_window_offset];
+  }
+
+  if (m_backend == Buffered) {
+    m_is_end_of_file = false;
+    if (m_current == m_end) {
+      m_is_end_of_file = true;
+      return 0;
+    }
+
+    return *m_current++;
+  }
+
   char c;
   const int count = std::fread(&c, sizeof(char), 1, m_file);
 
@@ -33,6 +219,13 @@ char FileStream::get() {
     return 0;
   }
 
+  // record the lines of the part of the file that is read for the first time
+  if (m_pos.loc == m_line_table_end) {
+    ++m_line_table_end;
+    if (c == '\n')
+      m_line_starts.push_back(m_line_table_end);
+  }
+
   if (c == '\n') {
     // -1 from the side effect of fread
     m_pos.row++;
@@ -46,6 +239,19 @@ char FileStream::get() {
 }
 
 char FileStream::peek() {
+  if (m_backend == Buffered) {
+    // peeking at the end of file has the same side effect as get
+    m_is_end_of_file = m_current == m_end;
+    return m_is_end_of_file ? 0 : *m_current;
+  }
+
+  if (m_backend == Streamed) {
+    char c = get();
+    if (!m_is_end_of_file)
+      --m_stream_pos;
+    return c;
+  }
+
   saveState();
   char c = get();
   restoreState();
@@ -57,32 +263,66 @@ char FileStream::get(char &c) {
   return c;
 }
 
-bool FileStream::good() { return std::ferror(m_file) == 0; }
+bool FileStream::good() {
+  if (m_backend == Buffered)
+    return m_open;
+
+  return std::ferror(m_file) == 0;
+}
 
 long FileStream::tellg() {
   // the byte offset
+  if (m_backend == Buffered)
+    return m_current - m_begin;
+  if (m_backend == Streamed)
+    return m_stream_pos;
+
   return std::ftell(m_file);
 }
 
 void FileStream::seekg(long pos) {
-  // update the current position
-  std::fseek(m_file, 0, SEEK_SET);
-  FilePos new_pos(1, 1, pos);
-  for (int i = 0; i < pos; ++i) {
-    char c = std::fgetc(m_file);
-    if (c == '\n') {
-      new_pos.row += 1;
-      new_pos.col = 0;
-    } else {
-      new_pos.col++;
-    }
+  if (m_backend == Buffered) {
+    assert(0 <= pos && pos <= m_end - m_begin && "seeking outside of the file");
+    m_current = m_begin + pos;
+    return;
+  }
+
+  if (m_backend == Streamed) {
+    assert(pos >= m_window_offset &&
+           "seeking back further than the backtrack window");
+    // seeking forward reads up to pos
+    while (pos > m_window_offset + static_cast<long>(m_storage.size()) &&
+           readChunk(m_stream_pos))
+      ;
+    assert(pos <= m_window_offset + static_cast<long>(m_storage.size()) &&
+           "seeking outside of the input");
+    m_stream_pos = pos;
+    return;
   }
 
-  // update the position
-  m_pos = new_pos;
+  // the line table gives the position, the file is only read where it has not
+  // been read before
+  extendLineTable(pos);
+  assert(pos <= m_line_table_end && "seeking outside of the file");
+  std::fseek(m_file, pos, SEEK_SET);
+  m_pos = getPos(pos);
   assert(tellg() == pos && "must be true if we have seekg");
 }
 
+void FileStream::extendLineTable(long pos) {
+  assert(m_backend == Stdio);
+  if (pos <= m_line_table_end)
+    return;
+
+  std::fseek(m_file, m_line_table_end, SEEK_SET);
+  int c;
+  while (m_line_table_end < pos && (c = std::fgetc(m_file)) != EOF) {
+    ++m_line_table_end;
+    if (c == '\n')
+      m_line_starts.push_back(m_line_table_end);
+  }
+}
+
 bool FileStream::eof() { return m_is_end_of_file; }
 
 void FileStream::saveState() {
@@ -100,7 +340,28 @@ void FileStream::restoreState() {
   m_is_in_save_state = false;
 }
 
-FilePos FileStream::getPos() { return m_pos; }
+FilePos FileStream::getPos() {
+  if (m_backend != Stdio)
+    return getPos(tellg());
+
+  return m_pos;
+}
+
+FilePos FileStream::getPos(long pos) {
+  // the line table only covers what has been read so far, reread the file up
+  // to pos if it is further
+  if (m_backend == Stdio && pos > m_line_table_end) {
+    long current = std::ftell(m_file);
+    extendLineTable(pos);
+    std::fseek(m_file, current, SEEK_SET);
+  }
+
+  // the last line that starts at or before pos
+  auto line = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), pos);
+  int row = line - m_line_starts.begin();
+  int col = pos - *(line - 1) + 1;
+  return FilePos(row, col, pos);
+}
 
 bool vcc::operator==(const FilePos &lhs, const FilePos &rhs) {
   return lhs.col == rhs.col && lhs.row == rhs.row;
@@ -113,29 +374,57 @@ std::ostream &vcc::operator<<(std::ostream &os, const FilePos &pos) {
 
 bool FileStream::is_open() { return m_open; }
 
+const std::string &FileStream::getName() const { return m_name; }
+
+FileStream::Backend FileStream::getBackend() const { return m_backend; }
+
+const char *FileStream::getBuffer() const {
+  assert(m_backend == Buffered && "there is no buffer to scan");
+  return m_begin;
+}
+
+long FileStream::getSize() const {
+  assert(m_backend == Buffered && "there is no buffer to scan");
+  return m_end - m_begin;
+}
+
 std::string FileStream::getLine(long pos) {
-  saveState();
-  long begin_line_start = -1;
-  std::fseek(m_file, 0, SEEK_SET);
-  for (int i = 0; i < pos; ++i) {
-    char c = std::fgetc(m_file);
-    if (c == '\n')
-      begin_line_start = i;
+  if (m_backend == Buffered) {
+    pos = std::min<long>(pos, m_end - m_begin);
+    std::size_t row = getPos(pos).row;
+    const char *line_begin = m_begin + m_line_starts[row - 1];
+    const char *line_end =
+        (row < m_line_starts.size()) ? m_begin + m_line_starts[row] - 1 : m_end;
+    return std::string(line_begin, line_end);
   }
-  // the loop above returns the last location of a '\n'
-  // adding one gives the new line
-  begin_line_start += 1; //
 
-  std::fseek(m_file, begin_line_start, SEEK_SET);
-  std::string line = "";
-  char c;
-  while ((c = std::fgetc(m_file)) != EOF) {
-    if (c == '\n')
-      break;
-    else
-      line += c;
+  if (m_backend == Streamed) {
+    // only what is left of the line in the window can be returned
+    std::size_t row = getPos(pos).row;
+    long line_begin = std::max(m_line_starts[row - 1], m_window_offset);
+
+    // the end of the line may not have been read yet
+    while (row == m_line_starts.size() && readChunk(line_begin))
+      ;
+    long line_end = (row < m_line_starts.size())
+                        ? m_line_starts[row] - 1
+                        : m_window_offset + m_storage.size();
+    // the whole line has left the window
+    if (line_end <= line_begin)
+      return "";
+    return std::string(m_storage.begin() + (line_begin - m_window_offset),
+                       m_storage.begin() + (line_end - m_window_offset));
   }
 
-  restoreState();
+  // the line starts where the line table says, only the line itself is read
+  long current = std::ftell(m_file);
+  std::size_t row = getPos(pos).row;
+  std::fseek(m_file, m_line_starts[row - 1], SEEK_SET);
+  std::string line;
+  int c;
+  while ((c = std::fgetc(m_file)) != EOF && c != '\n')
+    line += c;
+
+  std::fseek(m_file, current, SEEK_SET);
   return line;
 }
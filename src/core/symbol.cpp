@@ -0,0 +1,72 @@
+#include "core/symbol.h"
+#include "core/chunked_table.h"
+#include <cassert>
+#include <mutex>
+#include <unordered_map>
+
+using namespace vcc;
+
+namespace {
+class StringInterner {
+public:
+  StringInterner() { intern(""); }
+
+  std::uint32_t intern(std::string_view spelling) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.find(spelling);
+    if (it != m_ids.end())
+      return it->second;
+
+    // the table never moves its elements, so the key can view the spelling
+    std::uint32_t id = m_spellings.push(std::string(spelling));
+    m_ids.emplace(m_spellings.get(id), id);
+    return id;
+  }
+
+  /// takes no lock, the id was handed out by intern()
+  const std::string &getSpelling(std::uint32_t id) const {
+    assert(id < m_spellings.size() && "not an interned symbol");
+    return m_spellings.get(id);
+  }
+
+  std::size_t size() const { return m_spellings.size(); }
+
+  void clear() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_ids.clear();
+      m_spellings.clear();
+    }
+    intern("");
+  }
+
+private:
+  std::mutex m_mutex;
+  ChunkedTable<std::string> m_spellings;
+  std::unordered_map<std::string_view, std::uint32_t> m_ids;
+};
+} // namespace
+
+static StringInterner &getInterner() {
+  static StringInterner interner;
+  return interner;
+}
+
+Symbol Symbol::intern(std::string_view spelling) {
+  return Symbol(getInterner().intern(spelling));
+}
+
+Symbol Symbol::fromID(std::uint32_t id) {
+  assert(id < getInterner().size() && "not an interned symbol");
+  return Symbol(id);
+}
+
+void Symbol::clearTable() { getInterner().clear(); }
+
+const std::string &Symbol::str() const {
+  return getInterner().getSpelling(m_id);
+}
+
+std::ostream &vcc::operator<<(std::ostream &os, Symbol symbol) {
+  return os << symbol.str();
+}
@@ -1,28 +1,21 @@
 #include "core/type.h"
+#include <llvm/IR/DataLayout.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <string_view>
 
 using namespace vcc;
 
-bool Type::isBuiltin() const {
-  return dynamic_cast<const BuiltinType *>(this) != nullptr;
-}
+Type::Type(TypeKind kind) : m_kind(kind) {}
 
-bool Type::isStruct() const {
-  return dynamic_cast<const StructType *>(this) != nullptr;
-}
+bool Type::isBuiltin() const { return m_kind == BuiltinKind; }
 
-bool Type::isPointer() const {
-  return dynamic_cast<const PointerType *>(this) != nullptr;
-}
+bool Type::isStruct() const { return m_kind == StructKind; }
 
-bool Type::isArray() const {
-  return dynamic_cast<const ArrayType *>(this) != nullptr;
-}
+bool Type::isPointer() const { return m_kind == PointerKind; }
 
-bool Type::isVoid() const {
-  return dynamic_cast<const VoidType *>(this) != nullptr;
-}
+bool Type::isArray() const { return m_kind == ArrayKind; }
+
+bool Type::isVoid() const { return m_kind == VoidKind; }
 
 bool Type::isVoidPtr() const {
   if (!isPointer())
@@ -36,7 +29,8 @@ llvm::Type *Type::getType(ContextHolder holder) {
   return nullptr;
 }
 
-BuiltinType::BuiltinType(Builtin builtin) : m_builtin(builtin) {
+BuiltinType::BuiltinType(Builtin builtin)
+    : Type(BuiltinKind), m_builtin(builtin) {
   switch (m_builtin) {
   case Bool:
     m_bits_size = 1;
@@ -82,15 +76,13 @@ llvm::Type *BuiltinType::getType(ContextHolder holder) {
   }
 }
 
-StructType::StructType(const std::vector<Element> &element,
-                       const std::string &name)
-    : m_elements(element), m_name(name) {
-#ifdef NDEBUG
+StructType::StructType(const std::vector<Element> &element, Symbol name)
+    : Type(StructKind), m_elements(element), m_name(name) {
   for (int i = 0; i < m_elements.size(); ++i) {
     assert(m_elements[i].field_num == i &&
            "The array makes no sense otherwise");
+    m_element_index[m_elements[i].name] = i;
   }
-#endif
 }
 
 llvm::Type *StructType::getType(ContextHolder holder) {
@@ -105,41 +97,73 @@ llvm::Type *StructType::getType(ContextHolder holder) {
   }
 
   m_llvm_type = llvm::StructType::create(elements);
-  m_llvm_type->setName("struct." + m_name);
+  m_llvm_type->setName("struct." + m_name.str());
   return m_llvm_type;
 }
 
-// maybe we should use a string instead?
-std::optional<StructType::Element>
-StructType::getElement(const std::string &name) {
-  for (const Element &element : m_elements) {
-    if (element.name == name)
-      return std::make_optional<Element>(element);
+bool StructType::hasElement(Symbol name) const {
+  return m_element_index.find(name) != m_element_index.end();
+}
+
+const StructType::Element &StructType::getElement(Symbol name) const {
+  auto it = m_element_index.find(name);
+  assert(it != m_element_index.end() && "no such element");
+  return m_elements[it->second];
+}
+
+void StructType::computeLayout(ContextHolder holder) {
+  const llvm::DataLayout &data_layout = holder->module.getDataLayout();
+  const llvm::StructLayout *layout = data_layout.getStructLayout(
+      llvm::cast<llvm::StructType>(getType(holder)));
+  for (std::size_t i = 0; i < m_elements.size(); ++i) {
+    m_offsets.push_back(layout->getElementOffset(i));
+    m_sizes.push_back(
+        data_layout.getTypeAllocSize(m_elements[i].type->getType(holder)));
   }
-  return std::nullopt;
+  m_size = layout->getSizeInBytes();
 }
 
-PointerType::PointerType(Type *pointee) : m_pointee(pointee) {}
+uint64_t StructType::getElementOffset(ContextHolder holder, int field_num) {
+  if (m_offsets.size() != m_elements.size())
+    computeLayout(holder);
+  return m_offsets[field_num];
+}
+
+uint64_t StructType::getElementSize(ContextHolder holder, int field_num) {
+  if (m_sizes.size() != m_elements.size())
+    computeLayout(holder);
+  return m_sizes[field_num];
+}
+
+uint64_t StructType::getSize(ContextHolder holder) {
+  if (m_offsets.size() != m_elements.size())
+    computeLayout(holder);
+  return m_size;
+}
+
+PointerType::PointerType(Type *pointee)
+    : Type(PointerKind), m_pointee(pointee) {}
 
 Type *PointerType::getPointee() { return m_pointee; }
 const Type *PointerType::getPointee() const { return m_pointee; }
 
 llvm::Type *PointerType::getType(ContextHolder holder) {
-  return llvm::PointerType::get(m_pointee->getType(holder)->getContext(),
-                                /*AddressSpace*/ 0);
+  if (!m_llvm_type)
+    m_llvm_type = llvm::PointerType::get(holder->context, /*AddressSpace*/ 0);
+  return m_llvm_type;
 }
 
-ArrayType::ArrayType(Type *base, int count) : m_count(count), m_base(base) {}
+ArrayType::ArrayType(Type *base, int count)
+    : Type(ArrayKind), m_count(count), m_base(base) {}
 
 Type *ArrayType::getBase() { return m_base; }
 
 int ArrayType::getCount() { return m_count; }
 
 llvm::Type *ArrayType::getType(ContextHolder holder) {
-  if (m_llvm_type)
-    return m_llvm_type;
-
-  return llvm::ArrayType::get(m_base->getType(holder), m_count);
+  if (!m_llvm_type)
+    m_llvm_type = llvm::ArrayType::get(m_base->getType(holder), m_count);
+  return m_llvm_type;
 }
 
 void Type::dump() { std::cout << "unknown type"; }
@@ -185,62 +209,16 @@ const std::vector<StructType::Element> &StructType::getElements() const {
   return m_elements;
 }
 
-const std::string &StructType::getName() const { return m_name; }
-
-bool Type::isSame(Type *lhs, Type *rhs) {
-  if (lhs->isStruct() && rhs->isStruct()) {
-    StructType *the_lhs = lhs->getAs<StructType>();
-    StructType *the_rhs = rhs->getAs<StructType>();
-    if (the_lhs->getName() != the_rhs->getName())
-      return false;
-
-    auto rhs_elements = the_rhs->getElements();
-    auto lhs_elements = the_lhs->getElements();
-
-    if (lhs_elements.size() != rhs_elements.size())
-      return false;
-
-    for (int i = 0; i < lhs_elements.size(); ++i) {
-      assert(lhs_elements[i].field_num == rhs_elements[i].field_num &&
-             "invariant check");
-      if (lhs_elements[i].name != rhs_elements[i].name)
-        return false;
+Symbol StructType::getName() const { return m_name; }
 
-      if (!isSame(lhs_elements[i].type, rhs_elements[i].type)) {
-        return false;
-      }
-    }
+bool Type::isSame(Type *lhs, Type *rhs) { return lhs == rhs; }
 
-    return true;
-  }
-
-  if (lhs->isBuiltin() && rhs->isBuiltin()) {
-    return lhs->getAs<BuiltinType>()->getKind() ==
-           rhs->getAs<BuiltinType>()->getKind();
-  }
-
-  if (lhs->isPointer() && rhs->isPointer()) {
-    return isSame(lhs->getAs<PointerType>()->getPointee(),
-                  rhs->getAs<PointerType>()->getPointee());
-  }
-
-  if (lhs->isArray() && rhs->isArray()) {
-    if (lhs->getAs<ArrayType>()->getCount() !=
-        rhs->getAs<ArrayType>()->getCount())
-      return false;
-
-    return isSame(lhs->getAs<ArrayType>()->getBase(),
-                  rhs->getAs<ArrayType>()->getBase());
-  }
-
-  if (lhs->isVoid() && rhs->isVoid())
-    return true;
-
-  return false;
-}
+VoidType::VoidType() : Type(VoidKind) {}
 
 llvm::Type *VoidType::getType(ContextHolder holder) {
-  return llvm::Type::getVoidTy(holder->context);
+  if (!m_llvm_type)
+    m_llvm_type = llvm::Type::getVoidTy(holder->context);
+  return m_llvm_type;
 }
 
 void VoidType::dump() { std::cout << "void"; }
@@ -258,3 +236,46 @@ bool BuiltinType::isIntegerKind() const {
 }
 
 int BuiltinType::getBitSize() const { return m_bits_size; }
+
+TypeContext::TypeContext() {
+  for (BuiltinType::Builtin builtin :
+       {BuiltinType::Int, BuiltinType::Float, BuiltinType::Char,
+        BuiltinType::Bool, BuiltinType::Long, BuiltinType::Short})
+    m_builtins.push_back(m_arena.create<BuiltinType>(builtin));
+  m_void = m_arena.create<VoidType>();
+}
+
+BuiltinType *TypeContext::getBuiltinType(BuiltinType::Builtin builtin) {
+  assert(m_builtins[builtin]->getKind() == builtin);
+  return m_builtins[builtin];
+}
+
+VoidType *TypeContext::getVoidType() { return m_void; }
+
+PointerType *TypeContext::getPointerType(Type *pointee) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  PointerType *&pointer = m_pointers[pointee];
+  if (!pointer)
+    pointer = m_arena.create<PointerType>(pointee);
+  return pointer;
+}
+
+ArrayType *TypeContext::getArrayType(Type *base, int count) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ArrayType *&array = m_arrays[{base, count}];
+  if (!array)
+    array = m_arena.create<ArrayType>(base, count);
+  return array;
+}
+
+StructType *
+TypeContext::createStructType(const std::vector<StructType::Element> &elements,
+                              Symbol name) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_arena.create<StructType>(elements, name);
+}
+
+void TypeContext::printStats(std::ostream &os) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_arena.printStats(os);
+}
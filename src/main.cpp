@@ -28,9 +28,37 @@ llvm::cl::opt<bool> S("S", llvm::cl::desc("Emit Assembly"),
 llvm::cl::opt<std::string> output_filename("o",
                                            llvm::cl::desc("Output filename"),
                                            llvm::cl::init("output.o"));
-llvm::cl::opt<std::string> input_filename(llvm::cl::Positional,
-                                          llvm::cl::Required,
-                                          llvm::cl::desc("<input filename>"));
+llvm::cl::opt<bool> stdio_stream(
+    "stdio-stream",
+    llvm::cl::desc("Read the input one character at a time with stdio instead "
+                   "of mapping it into memory"),
+    llvm::cl::init(false));
+llvm::cl::opt<bool> pre_tokenize(
+    "pre-tokenize",
+    llvm::cl::desc("Lex the whole input before parsing it"),
+    llvm::cl::init(false));
+llvm::cl::opt<bool> print_memory(
+    "print-memory",
+    llvm::cl::desc("Print the memory used by the syntax tree and the types "
+                   "after each phase"),
+    llvm::cl::init(false));
+llvm::cl::opt<unsigned> error_limit(
+    "error-limit",
+    llvm::cl::desc("Stop after this many errors were reported, 0 for no limit"),
+    llvm::cl::init(20));
+llvm::cl::opt<unsigned> parse_threads(
+    "parse-threads",
+    llvm::cl::desc("Parse the function bodies on this many threads, 0 for one "
+                   "per core"),
+    llvm::cl::init(1));
+llvm::cl::list<std::string> entry_points(
+    "entry",
+    llvm::cl::desc("Only compile the functions reachable from this one, can "
+                   "be given more than once. Without it every function is "
+                   "compiled"));
+llvm::cl::opt<std::string>
+    input_filename(llvm::cl::Positional, llvm::cl::Required,
+                   llvm::cl::desc("<input filename, - for stdin>"));
 
 int main(int argc, char *argv[]) {
   // FIXME: code cleanup
@@ -38,25 +66,6 @@ int main(int argc, char *argv[]) {
   llvm::InitializeNativeTarget();
   llvm::InitializeNativeTargetAsmPrinter();
 
-  vcc::Parser parser = vcc::parseFile(input_filename.c_str());
-  vcc::ContextHolder holder = parser.getHolder();
-  vcc::Sema sema;
-
-  for (vcc::ASTBase *tree : parser.getSyntaxTree()) {
-    if (print_ast)
-      tree->debugDump();
-
-    vcc::dyncast<vcc::Statement>(tree)->codegen(holder);
-  }
-
-  // Create the analysis managers.
-  // These must be declared in this order so that they are destroyed in the
-  // correct order due to inter-analysis-manager references.
-  llvm::LoopAnalysisManager LAM;
-  llvm::FunctionAnalysisManager FAM;
-  llvm::CGSCCAnalysisManager CGAM;
-  llvm::ModuleAnalysisManager MAM;
-
   std::string targetTriple = llvm::sys::getDefaultTargetTriple();
   llvm::Triple theRealTriple = llvm::Triple(targetTriple);
   std::string error;
@@ -71,13 +80,48 @@ int main(int argc, char *argv[]) {
   std::optional<llvm::Reloc::Model> relocModel = std::make_optional(llvm::Reloc::Model::PIC_);
   llvm::TargetMachine *targetMachine = target->createTargetMachine(
       theRealTriple, "generic", "", options, relocModel);
-
-  holder->module.setDataLayout(targetMachine->createDataLayout());
   if (!targetMachine) {
     llvm::errs() << "cannot get target machine";
     return 1;
   }
 
+  vcc::CompilerOptions compiler_options;
+  // struct layouts are the ones of the target
+  compiler_options.data_layout =
+      targetMachine->createDataLayout().getStringRepresentation();
+  compiler_options.backend =
+      stdio_stream ? vcc::FileStream::Stdio : vcc::FileStream::Buffered;
+  compiler_options.mode = pre_tokenize ? vcc::lex::Tokenizer::PreTokenized
+                                       : vcc::lex::Tokenizer::Streaming;
+  compiler_options.error_limit = error_limit;
+  compiler_options.thread_count = parse_threads;
+  for (const std::string &entry_point : entry_points)
+    compiler_options.entry_points.push_back(vcc::Symbol::intern(entry_point));
+
+  vcc::CompilerInstance compiler(std::move(compiler_options));
+  bool success = compiler.compileFile(input_filename.c_str());
+  vcc::ContextHolder holder = compiler.getContext();
+  if (print_memory) {
+    std::cerr << "syntax tree:\n";
+    holder->ast.printStats(std::cerr);
+    std::cerr << "types:\n";
+    holder->types->printStats(std::cerr);
+  }
+  if (!success)
+    return 1;
+
+  if (print_ast)
+    for (vcc::Statement *tree : compiler.getSyntaxTree())
+      tree->debugDump();
+
+  // Create the analysis managers.
+  // These must be declared in this order so that they are destroyed in the
+  // correct order due to inter-analysis-manager references.
+  llvm::LoopAnalysisManager LAM;
+  llvm::FunctionAnalysisManager FAM;
+  llvm::CGSCCAnalysisManager CGAM;
+  llvm::ModuleAnalysisManager MAM;
+
   // Create the new pass manager builder.
   // Take a look at the PassBuilder constructor parameters for more
   // customization, e.g. specifying a TargetMachine or various debugging
@@ -0,0 +1,183 @@
+#include "core/ast.h"
+#include "core/driver.h"
+#include "core/parser.h"
+#include "core/type.h"
+#include "core/util.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+static std::vector<vcc::code::TreeCode>
+getChildCodes(const vcc::ASTBase *node) {
+  std::vector<vcc::code::TreeCode> codes;
+  for (const vcc::ASTBase *child : node->getChildren())
+    codes.push_back(child->getCode());
+  return codes;
+}
+
+TEST(ASTTest, ChildrenInSourceOrder) {
+  vcc::Parser parser = vcc::parseBuffer("struct vec2 {\n"
+                                        "    int a,\n"
+                                        "}\n"
+                                        "function foo gives int [int b,]{\n"
+                                        "    struct vec2 a;\n"
+                                        "    a.a = 10;\n"
+                                        "    ret b;\n"
+                                        "}\n");
+  ASSERT_FALSE(parser.haveError());
+  ASSERT_EQ(parser.getSyntaxTree().size(), 1);
+
+  const vcc::ASTBase *function = parser.getSyntaxTree()[0];
+  EXPECT_EQ(getChildCodes(function),
+            (std::vector<vcc::code::TreeCode>{
+                vcc::code::FunctionArgLists, vcc::code::DeclarationStatement,
+                vcc::code::AssignmentStatement, vcc::code::ReturnStatement}));
+
+  // the left hand side of an assignment comes first
+  const vcc::ASTBase *assignment = function->getChildren()[2];
+  EXPECT_EQ(getChildCodes(assignment),
+            (std::vector<vcc::code::TreeCode>{vcc::code::MemberAccessExpression,
+                                              vcc::code::ConstantExpr}));
+  for (const vcc::ASTBase *child : assignment->getChildren())
+    EXPECT_EQ(child->getParent(), assignment);
+}
+
+TEST(ASTTest, ReparentedChildLeavesOldParent) {
+  vcc::ConstantExpr constant(1, vcc::SourceLocation());
+  vcc::ASTBase first(vcc::code::ReturnStatement, {&constant},
+                     vcc::SourceLocation());
+  vcc::ASTBase second(vcc::code::ReturnStatement, {&constant},
+                      vcc::SourceLocation());
+
+  // the node is only in the children of its last parent
+  EXPECT_TRUE(first.getChildren().empty());
+  ASSERT_EQ(second.getChildren().size(), 1u);
+  EXPECT_EQ(second.getChildren()[0], &constant);
+  EXPECT_EQ(constant.getParent(), &second);
+}
+
+TEST(ASTTest, KindChecks) {
+  vcc::Parser parser = vcc::parseBuffer("function foo gives int [int b,]{\n"
+                                        "    ptr int c = ref<b>;\n"
+                                        "    ret deref<c>;\n"
+                                        "}\n");
+  ASSERT_FALSE(parser.haveError());
+  vcc::ASTBase *function = parser.getSyntaxTree()[0];
+  EXPECT_TRUE(vcc::isa<vcc::Statement>(function));
+  EXPECT_TRUE(vcc::isa<vcc::FunctionDecl>(function));
+  EXPECT_FALSE(vcc::isa<vcc::Expression>(function));
+  EXPECT_EQ(vcc::getASTClassName(function), "FunctionDecl");
+
+  // the dereference is both an expression and a locator expression
+  vcc::ASTBase *ret = function->getChildren()[2];
+  vcc::ASTBase *deref = ret->getChildren()[0];
+  EXPECT_TRUE(vcc::isa<vcc::Expression>(deref));
+  EXPECT_TRUE(vcc::isa<vcc::LocatorExpression>(deref));
+  EXPECT_EQ(vcc::dyncast<vcc::DeRefExpression>(deref), deref);
+  EXPECT_EQ(vcc::dyncast<vcc::RefExpression>(deref), nullptr);
+  EXPECT_EQ(vcc::dyncast<vcc::Statement>(deref), nullptr);
+  EXPECT_FALSE(vcc::isa<vcc::Expression>(static_cast<vcc::ASTBase *>(nullptr)));
+
+  vcc::BuiltinType integer(vcc::BuiltinType::Int);
+  vcc::PointerType pointer(&integer);
+  vcc::Type *type = &pointer;
+  EXPECT_TRUE(vcc::isa<vcc::PointerType>(type));
+  EXPECT_FALSE(vcc::isa<vcc::BuiltinType>(type));
+  EXPECT_EQ(vcc::dyncast<vcc::PointerType>(type)->getPointee(), &integer);
+}
+
+TEST(ASTTest, TypesSetBySema) {
+  vcc::Parser parser = vcc::parseBuffer("function foo gives long [int b,]{\n"
+                                        "    long c = cast<long>(b);\n"
+                                        "    ret c * b + 1;\n"
+                                        "}\n");
+  ASSERT_FALSE(parser.haveError());
+  vcc::TypeContext &types = *parser.getHolder()->types;
+
+  // ret (c * b) + 1, every expression has its type before codegen
+  const vcc::ASTBase *ret = parser.getSyntaxTree()[0]->getChildren()[2];
+  auto *add = vcc::dyncast<vcc::BinaryExpression>(ret->getChildren()[0]);
+  ASSERT_NE(add, nullptr);
+  vcc::Type *long_type = types.getBuiltinType(vcc::BuiltinType::Long);
+  EXPECT_EQ(add->getType(), long_type);
+  EXPECT_EQ(add->getLHS()->getType(), long_type);
+  EXPECT_EQ(add->getRHS()->getType(),
+            types.getBuiltinType(vcc::BuiltinType::Int));
+}
+
+TEST(ASTTest, VariablesBoundBySema) {
+  vcc::Parser parser = vcc::parseBuffer("function foo gives int [int b,]{\n"
+                                        "    int c = b;\n"
+                                        "    if b then\n"
+                                        "        int c = 2;\n"
+                                        "        b = c;\n"
+                                        "    end\n"
+                                        "    ret c;\n"
+                                        "}\n");
+  ASSERT_FALSE(parser.haveError());
+  vcc::ASTBase *function = parser.getSyntaxTree()[0];
+  auto *outer_c =
+      vcc::dyncast<vcc::DeclarationStatement>(function->getChildren()[1]);
+  vcc::ASTBase *if_statement = function->getChildren()[2];
+  auto *inner_c =
+      vcc::dyncast<vcc::DeclarationStatement>(if_statement->getChildren()[1]);
+  ASSERT_NE(outer_c, nullptr);
+  ASSERT_NE(inner_c, nullptr);
+
+  // the argument, and the c of the if that shadows the outer one
+  vcc::ASTBase *assignment = if_statement->getChildren()[2];
+  auto *b = vcc::dyncast<vcc::IdentifierExpr>(assignment->getChildren()[0]);
+  auto *c = vcc::dyncast<vcc::IdentifierExpr>(assignment->getChildren()[1]);
+  EXPECT_EQ(b->getVariable(), &vcc::dyncast<vcc::FunctionDecl>(function)
+                                   ->getArgList()
+                                   ->getArgs()[0]);
+  EXPECT_EQ(c->getVariable(), inner_c->getVariable());
+
+  vcc::ASTBase *ret = function->getChildren()[3];
+  EXPECT_EQ(vcc::dyncast<vcc::IdentifierExpr>(ret->getChildren()[0])
+                ->getVariable(),
+            outer_c->getVariable());
+}
+
+TEST(ASTTest, ConstantsFoldedBySema) {
+  vcc::Parser parser = vcc::parseBuffer("function foo gives long [int b,]{\n"
+                                        "    long c = cast<long>(4 * 8);\n"
+                                        "    char d = cast<char>(300);\n"
+                                        "    float e = cast<float>(3) / "
+                                        "cast<float>(2);\n"
+                                        "    int f = b * 1 + 0;\n"
+                                        "    long g = b + cast<long>(0);\n"
+                                        "    ret c;\n"
+                                        "}\n");
+  ASSERT_FALSE(parser.haveError());
+  const vcc::ASTBase *function = parser.getSyntaxTree()[0];
+  auto initializer = [&](int statement) {
+    return vcc::dyncast<vcc::DeclarationStatement>(
+               function->getChildren()[statement])
+        ->getExpression();
+  };
+
+  // each constant keeps the width of its type
+  const vcc::ConstantValue *c = initializer(1)->getConstant();
+  ASSERT_NE(c, nullptr);
+  EXPECT_EQ(c->getInteger().getBitWidth(), 64u);
+  EXPECT_EQ(c->getInteger().getSExtValue(), 32);
+  const vcc::ConstantValue *d = initializer(2)->getConstant();
+  ASSERT_NE(d, nullptr);
+  EXPECT_EQ(d->getInteger().getBitWidth(), 8u);
+  EXPECT_EQ(d->getInteger().getSExtValue(), 44);
+  const vcc::ConstantValue *e = initializer(3)->getConstant();
+  ASSERT_NE(e, nullptr);
+  EXPECT_EQ(e->getFloat().convertToFloat(), 1.5f);
+
+  // (b * 1) + 0 is b
+  auto *add = vcc::dyncast<vcc::BinaryExpression>(initializer(4));
+  EXPECT_EQ(add->getConstant(), nullptr);
+  auto *multiply = vcc::dyncast<vcc::BinaryExpression>(add->getSimplified());
+  ASSERT_NE(multiply, nullptr);
+  EXPECT_EQ(multiply->getSimplified(), multiply->getLHS());
+
+  // b would have to be extended to a long, the addition stays
+  auto *widened = vcc::dyncast<vcc::BinaryExpression>(initializer(5));
+  EXPECT_EQ(widened->getSimplified(), nullptr);
+}
@@ -0,0 +1,75 @@
+#include "core/ast_context.h"
+#include "core/driver.h"
+#include "core/parser.h"
+
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+
+namespace {
+struct Counted {
+  explicit Counted(int &count) : count(count) { ++count; }
+  ~Counted() { --count; }
+  int &count;
+};
+
+struct alignas(64) Aligned {
+  char c;
+};
+} // namespace
+
+TEST(ASTContextTest, Allocation) {
+  int count = 0;
+  {
+    vcc::ASTContext context;
+    for (int i = 0; i < 10000; ++i)
+      context.create<Counted>(count);
+    EXPECT_EQ(count, 10000);
+    EXPECT_EQ(context.getBytesAllocated(), 10000 * sizeof(Counted));
+    EXPECT_GE(context.getBytesReserved(), context.getBytesAllocated());
+
+    char *c = context.create<char>('a');
+    Aligned *aligned = context.create<Aligned>();
+    EXPECT_EQ(*c, 'a');
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % 64, 0);
+
+    // larger than a slab
+    void *large = context.allocate(vcc::ASTContext::SlabSize * 2, 8);
+    EXPECT_NE(large, nullptr);
+  }
+  // everything is destroyed with the context
+  EXPECT_EQ(count, 0);
+}
+
+/// the bytes of phase in the output of printStats, or -1 if it is missing
+static long getPhaseBytes(const std::string &stats, const std::string &phase) {
+  std::size_t at = stats.find(phase + ": ");
+  if (at == std::string::npos)
+    return -1;
+  return std::stol(stats.substr(at + phase.size() + 2));
+}
+
+TEST(ASTContextTest, BytesPerPhase) {
+  // the constant is folded by Sema, which allocates it in the arena too
+  vcc::Parser parser = vcc::parseBuffer("function f gives int [int x,]{\n"
+                                        "    int y = 1 + 2;\n"
+                                        "    ret x + y;\n"
+                                        "}\n");
+  vcc::ASTContext &ast = parser.getHolder()->ast;
+  std::size_t analyzed = ast.getBytesAllocated();
+  EXPECT_GT(analyzed, 0);
+
+  for (vcc::Statement *base : parser.getSyntaxTree())
+    base->codegen(parser.getHolder());
+  ast.endPhase("codegen");
+
+  std::ostringstream stats;
+  ast.printStats(stats);
+  long parse = getPhaseBytes(stats.str(), "parse");
+  long sema = getPhaseBytes(stats.str(), "sema");
+  EXPECT_GT(parse, 0);
+  EXPECT_GT(sema, 0);
+  EXPECT_EQ(parse + sema, analyzed);
+  EXPECT_GE(getPhaseBytes(stats.str(), "codegen"), 0);
+}
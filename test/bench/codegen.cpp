@@ -0,0 +1,63 @@
+// Code generation benchmark
+//
+// Parses a .vcc file and generates its IR, and prints the time taken by each
+// phase. Without a file the input is a large generated file that goes
+// through struct members, arrays and pointers, where the type queries of the
+// code generator are the hottest. -j <threads> parses the function bodies on
+// that many threads, 0 for one per core. -entry <function> only compiles what
+// is reachable from function, compute_0 leaves out all but two functions of
+// the generated file.
+#include "core/driver.h"
+#include "core/parser.h"
+#include "generate.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace vcc;
+
+int main(int argc, char *argv[]) {
+  unsigned thread_count = 1;
+  std::vector<Symbol> entry_points;
+  while (argc > 2 && argv[1][0] == '-') {
+    std::string flag = argv[1];
+    if (flag == "-j")
+      thread_count = std::stoul(argv[2]);
+    else if (flag == "-entry")
+      entry_points.push_back(Symbol::intern(argv[2]));
+    else
+      break;
+    argc -= 2;
+    argv += 2;
+  }
+
+  std::string source;
+  if (argc < 2)
+    source = generateCodegenSource(20000);
+
+  auto start = std::chrono::steady_clock::now();
+  Parser parser =
+      argc < 2 ? parseBuffer(source, "generated.vcc", lex::Tokenizer::Streaming,
+                             20, thread_count, entry_points)
+               : parseFile(argv[1], FileStream::Buffered,
+                           lex::Tokenizer::Streaming, 20, thread_count,
+                           entry_points);
+  auto parsed = std::chrono::steady_clock::now();
+  for (Statement *statement : parser.getSyntaxTree())
+    statement->codegen(parser.getHolder());
+  auto end = std::chrono::steady_clock::now();
+
+  if (parser.haveError()) {
+    std::cerr << "the input does not compile\n";
+    return 1;
+  }
+
+  std::cout << (argc < 2 ? "generated.vcc" : argv[1]) << ": parse "
+            << std::chrono::duration<double, std::milli>(parsed - start).count()
+            << " ms, codegen "
+            << std::chrono::duration<double, std::milli>(end - parsed).count()
+            << " ms\n";
+  return 0;
+}
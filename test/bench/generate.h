@@ -0,0 +1,51 @@
+#ifndef TEST_BENCH_GENERATE_H
+#define TEST_BENCH_GENERATE_H
+
+#include <string>
+
+/// a .vcc file of function_count small functions, with comments
+inline std::string generateSource(int function_count) {
+  std::string source;
+  for (int i = 0; i < function_count; ++i) {
+    std::string name = "helper_" + std::to_string(i);
+    source += "# " + name + " is generated\n";
+    source += "function " + name + "\ngives int [int a, int b,]{\n";
+    source += "    int c = a + b * 3;\n";
+    source += "    if c gt 10 then\n";
+    source += "        c = c - 1;\n";
+    source += "    end\n";
+    source += "    ret add_two(c, a,); # calling something\n";
+    source += "}\n\n";
+  }
+  return source;
+}
+
+/// A .vcc file of function_count functions that compiles, going through
+/// struct members, arrays, pointers and calls like real code does
+inline std::string generateCodegenSource(int function_count) {
+  std::string source = "struct point {\n    int x,\n    int y,\n}\n\n"
+                       "struct box {\n    struct point corner,\n"
+                       "    array (8) int values,\n}\n\n"
+                       "function add_two gives int [int a, int b,]{\n"
+                       "    ret a + b;\n}\n\n";
+  for (int i = 0; i < function_count; ++i) {
+    source += "function compute_" + std::to_string(i) +
+              "\ngives int [ptr struct box b, int n,]{\n";
+    source += "    int sum = 0;\n";
+    source += "    int i = 0;\n";
+    source += "    while i lt n then\n";
+    source += "        sum = sum + deref<b>.values[i] * 3;\n";
+    source += "        i = i + 1;\n";
+    source += "    end\n";
+    source += "    struct box local;\n";
+    source += "    local.corner.x = sum;\n";
+    source += "    if local.corner.x gt 10 then\n";
+    source += "        sum = sum - deref<b>.corner.y;\n";
+    source += "    end\n";
+    source += "    ret add_two(sum, local.values[2],);\n";
+    source += "}\n\n";
+  }
+  return source;
+}
+
+#endif
@@ -0,0 +1,97 @@
+// Lexing benchmark
+//
+// Generates .vcc files of increasing size and lexes each of them the way the
+// parser does (a peek before every token). The time spent per byte must stay
+// roughly the same as the input grows, otherwise something in the lexer or
+// the stream went quadratic again. It is not run by ctest, the timings are
+// only meaningful on an idle machine.
+#include "core/lex.h"
+#include "generate.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace vcc;
+
+/// returns the number of nanoseconds taken per byte
+static double lexFile(const char *path, long size, FileStream::Backend backend,
+                      int &token_count) {
+  auto start = std::chrono::steady_clock::now();
+
+  FileStream stream(path, backend);
+  lex::Tokenizer tokenizer(stream);
+  token_count = 1;
+  while (tokenizer.getCurrentType() != lex::EndOfFile) {
+    tokenizer.peek();
+    tokenizer.consume();
+    ++token_count;
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / size;
+}
+
+int main(int argc, char *argv[]) {
+  // --stdio also times the old stdio backend on the smallest input, it
+  // is quadratic so anything larger takes minutes
+  bool time_stdio = argc > 1 && std::string(argv[1]) == "--stdio";
+  const char *path = "lex_bench_input.vcc";
+
+  double smallest = 0, largest = 0;
+  for (int function_count = 256; function_count <= 8192; function_count *= 2) {
+    std::string source = generateSource(function_count);
+    std::ofstream(path, std::ios::binary) << source;
+
+    int token_count;
+    double per_byte =
+        lexFile(path, source.size(), FileStream::Buffered, token_count);
+    std::cout << source.size() << " bytes, " << token_count
+              << " tokens: " << per_byte << " ns/byte";
+
+    if (time_stdio && function_count == 256)
+      std::cout << " (stdio: "
+                << lexFile(path, source.size(), FileStream::Stdio, token_count)
+                << " ns/byte)";
+    std::cout << "\n";
+
+    if (smallest == 0)
+      smallest = per_byte;
+    largest = per_byte;
+  }
+
+  // pre-tokenizing a file of tens of thousands of functions, on one thread
+  // and then split across all cores
+  std::string source = generateSource(65536);
+  std::ofstream(path, std::ios::binary) << source;
+  FileStream stream(path);
+  int sequential_count = 0;
+  for (unsigned thread_count : {1u, 0u}) {
+    auto start = std::chrono::steady_clock::now();
+    auto tokens = lex::Tokenizer::tokenize(stream, thread_count);
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "tokenize " << source.size() << " bytes on "
+              << (thread_count ? "1 thread" : "all threads") << ": "
+              << std::chrono::duration<double, std::milli>(end - start).count()
+              << " ms\n";
+
+    if (thread_count == 1)
+      sequential_count = tokens->size();
+    else if (tokens->size() != sequential_count) {
+      std::cerr << "the parallel lexer lost tokens\n";
+      return 1;
+    }
+  }
+  std::remove(path);
+
+  // the largest input is 32 times the smallest one, anything that is not
+  // linear would show up as a large multiple here
+  if (largest > smallest * 4) {
+    std::cerr << "lexing time is not linear in the input size\n";
+    return 1;
+  }
+
+  return 0;
+}
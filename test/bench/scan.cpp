@@ -0,0 +1,142 @@
+// Scanning benchmark
+//
+// Lexes a large generated .vcc file once with every scan kernel the cpu
+// supports, and prints the time taken per byte by the kernels alone and by
+// the whole lexer, and how much faster than the scalar kernel that is. Fails
+// if the kernels do not find the same tokens.
+#include "core/lex.h"
+#include "core/scan.h"
+#include "generate.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace vcc;
+
+static const char *kernelName(scan::Kernel kernel) {
+  switch (kernel) {
+  case scan::Scalar:
+    return "scalar";
+  case scan::SSE2:
+    return "sse2";
+  case scan::AVX2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+/// the number of words and symbols found by the kernels alone, resolved once
+/// like the lexer does
+static long scanWords(const std::string &source) {
+  const scan::KernelTable &kernel = scan::getKernelTable();
+  const char *at = source.data();
+  const char *end = at + source.size();
+  long count = 0;
+  while ((at = kernel.skip_white_space(at, end)) != end) {
+    if (*at == '#') {
+      at = kernel.find_new_line(at, end);
+      continue;
+    }
+
+    const char *word_end = kernel.find_token_end(at, end);
+    at = word_end == at ? at + 1 : word_end;
+    ++count;
+  }
+  return count;
+}
+
+static long lexTokens(const char *path) {
+  FileStream stream(path);
+  lex::Tokenizer tokenizer(stream);
+  long count = 1;
+  while (tokenizer.getCurrentType() != lex::EndOfFile) {
+    tokenizer.consume();
+    ++count;
+  }
+  return count;
+}
+
+/// nanoseconds taken per byte by function
+template <typename Function>
+static double timePerByte(long size, int repeat, Function function) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i)
+    function();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (static_cast<double>(size) * repeat);
+}
+
+/// the functions of generateSource, each under a block of long comment
+/// lines, which is where scanning many characters at once pays off
+static std::string generateCommentedSource(int function_count) {
+  std::string comment = "#" + std::string(120, '-') + "\n";
+  std::string source;
+  std::string plain = generateSource(function_count);
+  for (std::size_t at = 0; at < plain.size();) {
+    std::size_t next = plain.find("function", at + 1);
+    if (next == std::string::npos)
+      next = plain.size();
+    source += comment + comment + comment + comment;
+    source.append(plain, at, next - at);
+    at = next;
+  }
+  return source;
+}
+
+/// times every kernel on source, returns false if they do not agree
+static bool benchKernels(const char *name, const std::string &source) {
+  const char *path = "scan_bench_input.vcc";
+  const int repeat = 8;
+  std::ofstream(path, std::ios::binary) << source;
+  std::cout << name << ", " << source.size() << " bytes\n";
+
+  long expected_words = -1, expected_tokens = -1;
+  double scalar_scan_time = 0, scalar_lex_time = 0;
+  bool agree = true;
+  for (scan::Kernel kernel : {scan::Scalar, scan::SSE2, scan::AVX2}) {
+    if (!scan::setKernel(kernel))
+      continue;
+
+    long words = 0, tokens = 0;
+    double scan_time = timePerByte(source.size(), repeat,
+                                   [&] { words = scanWords(source); });
+    double lex_time =
+        timePerByte(source.size(), repeat, [&] { tokens = lexTokens(path); });
+    if (kernel == scan::Scalar) {
+      scalar_scan_time = scan_time;
+      scalar_lex_time = lex_time;
+    }
+    std::cout << "  " << kernelName(kernel) << ": scan " << scan_time
+              << " ns/byte (" << scalar_scan_time / scan_time
+              << "x scalar), lex " << lex_time << " ns/byte ("
+              << scalar_lex_time / lex_time << "x scalar)\n";
+
+    if (expected_words == -1) {
+      expected_words = words;
+      expected_tokens = tokens;
+    }
+    agree &= words == expected_words && tokens == expected_tokens;
+  }
+  scan::setKernel(scan::getBestKernel());
+  std::remove(path);
+  return agree;
+}
+
+int main() {
+  std::cout << "best kernel is " << kernelName(scan::getBestKernel()) << "\n";
+  // short runs between tokens, the kernels only get a few characters at a
+  // time, and then long comment lines
+  bool agree = benchKernels("generated", generateSource(16384));
+  agree &= benchKernels("commented", generateCommentedSource(16384));
+
+  if (!agree) {
+    std::cerr << "the scan kernels do not agree\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -1,7 +1,14 @@
+#include "core/context.h"
 #include "core/driver.h"
 #include "core/parser.h"
+#include "core/util.h"
 
+#include <fstream>
 #include <gtest/gtest.h>
+#include <iterator>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <thread>
 
 TEST(CompTest, TestCompile) {
   vcc::Parser parser = vcc::parseFile("resource/comp.vcc");
@@ -11,3 +18,318 @@ TEST(CompTest, TestCompile) {
 
   EXPECT_EQ(parser.haveError(), false);
 }
+
+TEST(CompTest, TestCompilePreTokenized) {
+  vcc::Parser parser =
+      vcc::parseFile("resource/comp.vcc", vcc::FileStream::Buffered,
+                     vcc::lex::Tokenizer::PreTokenized);
+  for (vcc::Statement *base : parser.getSyntaxTree()) {
+    base->codegen(parser.getHolder());
+  }
+
+  EXPECT_EQ(parser.haveError(), false);
+}
+
+TEST(CompTest, TestCompileStdin) {
+  ASSERT_TRUE(std::freopen("resource/comp.vcc", "rb", stdin));
+  vcc::Parser parser = vcc::parseFile("-");
+  for (vcc::Statement *base : parser.getSyntaxTree()) {
+    base->codegen(parser.getHolder());
+  }
+
+  EXPECT_EQ(parser.haveError(), false);
+}
+
+TEST(CompTest, TestCompileBuffer) {
+  std::ifstream file("resource/comp.vcc");
+  std::string source((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+
+  vcc::Parser parser = vcc::parseBuffer(source, "comp.vcc");
+  ASSERT_FALSE(parser.getSyntaxTree().empty());
+  for (vcc::Statement *base : parser.getSyntaxTree()) {
+    base->codegen(parser.getHolder());
+  }
+
+  EXPECT_EQ(parser.haveError(), false);
+}
+
+TEST(CompTest, TestCompileParallel) {
+  vcc::Parser parser =
+      vcc::parseFile("resource/comp.vcc", vcc::FileStream::Buffered,
+                     vcc::lex::Tokenizer::Streaming, 20, /*thread_count*/ 4);
+  ASSERT_FALSE(parser.getSyntaxTree().empty());
+  for (vcc::Statement *base : parser.getSyntaxTree()) {
+    base->codegen(parser.getHolder());
+  }
+
+  EXPECT_EQ(parser.haveError(), false);
+}
+
+TEST(CompTest, TestMissingFile) {
+  vcc::Parser parser = vcc::parseFile("resource/does-not-exist.vcc");
+  EXPECT_TRUE(parser.haveError());
+  EXPECT_TRUE(parser.getSyntaxTree().empty());
+}
+
+// one error in each function, and one between them
+static const char *broken_source = "function a gives int [int x,]{\n"
+                                   "    int y = x +;\n"
+                                   "    ret x;\n"
+                                   "}\n"
+                                   "function b gives int [int x,]{\n"
+                                   "    if then\n"
+                                   "        x = 1;\n"
+                                   "    end\n"
+                                   "    ret x;\n"
+                                   "}\n"
+                                   "+ garbage\n"
+                                   "function c gives int [int x,]{\n"
+                                   "    ret x\n"
+                                   "}\n"
+                                   "function d gives int [int x,]{\n"
+                                   "    ret x;\n"
+                                   "}\n";
+
+TEST(CompTest, TestRecoverFromSyntaxErrors) {
+  vcc::Parser parser = vcc::parseBuffer(broken_source);
+  EXPECT_EQ(parser.getHolder()->diagnostics.getErrorCount(), 4);
+  // every function is still there, without its broken statements
+  EXPECT_EQ(parser.getSyntaxTree().size(), 4);
+}
+
+TEST(CompTest, TestErrorLimit) {
+  vcc::Parser parser = vcc::parseBuffer(
+      broken_source, "<buffer>", vcc::lex::Tokenizer::Streaming, 2);
+  EXPECT_TRUE(parser.getHolder()->diagnostics.reachedErrorLimit());
+  EXPECT_EQ(parser.getHolder()->diagnostics.getErrorCount(), 3);
+  EXPECT_EQ(parser.getSyntaxTree().size(), 2);
+}
+
+TEST(CompTest, TestErrorLimitParallel) {
+  // the bodies are parsed on other threads, but parsing still stops where
+  // the sequential parser does
+  vcc::Parser parser =
+      vcc::parseBuffer(broken_source, "<buffer>",
+                       vcc::lex::Tokenizer::Streaming, 2, /*thread_count*/ 4);
+  EXPECT_TRUE(parser.getHolder()->diagnostics.reachedErrorLimit());
+  EXPECT_EQ(parser.getHolder()->diagnostics.getErrorCount(), 3);
+  EXPECT_EQ(parser.getSyntaxTree().size(), 2);
+}
+
+TEST(CompTest, TestErrorLimitEntryPoints) {
+  std::vector<vcc::Symbol> entry_points;
+  for (const char *name : {"a", "b", "c", "d"})
+    entry_points.push_back(vcc::Symbol::intern(name));
+  vcc::Parser parser = vcc::parseBuffer(broken_source, "<buffer>",
+                                        vcc::lex::Tokenizer::Streaming, 2,
+                                        /*thread_count*/ 1, entry_points);
+  EXPECT_TRUE(parser.getHolder()->diagnostics.reachedErrorLimit());
+  EXPECT_EQ(parser.getHolder()->diagnostics.getErrorCount(), 3);
+  EXPECT_EQ(parser.getSyntaxTree().size(), 2);
+}
+
+TEST(CompTest, TestErrorLimitBuffered) {
+  vcc::SourceManager sources;
+  vcc::DiagnosticDriver diagnostics(sources, /*buffered*/ true);
+  diagnostics.setErrorLimit(2);
+  testing::internal::CaptureStderr();
+  for (const char *message : {"first", "second", "third", "fourth"})
+    diagnostics.diag(message);
+  EXPECT_EQ(testing::internal::GetCapturedStderr(), "");
+
+  // the limit is kept with the messages, after the ones it cuts off
+  EXPECT_EQ(diagnostics.getMessages(),
+            (std::vector<std::string>{
+                "first\n", "second\n",
+                "too many errors emitted, stopping now\n"}));
+}
+
+TEST(CompTest, TestReportAllTypeErrors) {
+  vcc::Parser parser = vcc::parseBuffer("function a gives int [int x,]{\n"
+                                        "    x = \"hello\";\n"
+                                        "    ret x;\n"
+                                        "}\n"
+                                        "function b gives int [int x,]{\n"
+                                        "    int y = \"hello\";\n"
+                                        "    ret x;\n"
+                                        "}\n");
+  // both are found by Sema, before any code is generated
+  EXPECT_EQ(parser.getHolder()->diagnostics.getErrorCount(), 2);
+  EXPECT_EQ(parser.getSyntaxTree().size(), 2);
+}
+
+TEST(CompTest, TestSemaErrors) {
+  vcc::Parser parser = vcc::parseBuffer("struct vec2 {\n"
+                                        "    int x,\n"
+                                        "}\n"
+                                        "function a gives int [int x,]{\n"
+                                        "    ret y;\n"
+                                        "}\n"
+                                        "function b gives int [int x,]{\n"
+                                        "    struct vec2 v;\n"
+                                        "    ret v.z + missing(x,);\n"
+                                        "}\n"
+                                        "function c gives int [int x,]{\n"
+                                        "    ret deref<x> + a(x, x,);\n"
+                                        "}\n");
+  // undefined variable and function, unknown member, dereference of an int
+  // and the wrong number of arguments
+  EXPECT_EQ(parser.getHolder()->diagnostics.getErrorCount(), 5);
+}
+
+TEST(CompTest, TestSyntaxAndTypeErrors) {
+  const char *source = "function a gives int [int x,]{\n"
+                       "    int y = x +;\n"
+                       "    ret y;\n"
+                       "}\n"
+                       "function b gives int [int x,]{\n"
+                       "    ret a(missing,);\n"
+                       "}\n";
+  for (unsigned thread_count : {1u, 4u}) {
+    testing::internal::CaptureStderr();
+    vcc::Parser parser = vcc::parseBuffer(
+        source, "<buffer>", vcc::lex::Tokenizer::Streaming, 20, thread_count);
+    std::string errors = testing::internal::GetCapturedStderr();
+
+    // the syntax error in a does not hide the type error in b. The body of a
+    // is not checked, y was dropped with its broken declaration
+    EXPECT_EQ(parser.getHolder()->diagnostics.getErrorCount(), 2);
+    EXPECT_NE(errors.find("<buffer>:2:"), std::string::npos);
+    EXPECT_NE(errors.find("undefined variable missing"), std::string::npos);
+    EXPECT_EQ(errors.find("undefined variable y"), std::string::npos);
+  }
+}
+
+TEST(CompTest, TestRecoverParallel) {
+  testing::internal::CaptureStderr();
+  vcc::Parser parser = vcc::parseBuffer(
+      broken_source, "<buffer>", vcc::lex::Tokenizer::Streaming, 20, 4);
+  std::string errors = testing::internal::GetCapturedStderr();
+  EXPECT_EQ(parser.getHolder()->diagnostics.getErrorCount(), 4);
+
+  // the functions and the errors come in source order, whichever thread
+  // parsed them
+  std::vector<std::string> names;
+  for (vcc::Statement *base : parser.getSyntaxTree())
+    names.push_back(vcc::dyncast<vcc::FunctionDecl>(base)->getName().str());
+  EXPECT_EQ(names, (std::vector<std::string>{"a", "b", "c", "d"}));
+
+  std::size_t first = errors.find("<buffer>:2:16");
+  std::size_t second = errors.find("<buffer>:6:8");
+  std::size_t third = errors.find("<buffer>:11:1");
+  std::size_t fourth = errors.find("<buffer>:14:1");
+  ASSERT_NE(fourth, std::string::npos);
+  EXPECT_LT(first, second);
+  EXPECT_LT(second, third);
+  EXPECT_LT(third, fourth);
+}
+
+TEST(CompTest, TestParseReachableOnly) {
+  vcc::Parser parser = vcc::parseBuffer(
+      "external function puts gives int [ptr char s,]\n"
+      "function unused gives int [int x,]{\n"
+      "    this body is never parsed\n"
+      "}\n"
+      "function square gives int [int x,]{\n"
+      "    ret x * x;\n"
+      "}\n"
+      "function helper gives int [int x,]{\n"
+      "    ret square(x,);\n"
+      "}\n"
+      "function main gives int [int x,]{\n"
+      "    ret helper(x,) + 1;\n"
+      "}\n",
+      "<buffer>", vcc::lex::Tokenizer::Streaming, 20, 1,
+      {vcc::Symbol::intern("main")});
+  ASSERT_FALSE(parser.haveError());
+
+  std::vector<std::string> names;
+  for (vcc::Statement *base : parser.getSyntaxTree())
+    names.push_back(vcc::dyncast<vcc::FunctionDecl>(base)->getName().str());
+  EXPECT_EQ(names,
+            (std::vector<std::string>{"puts", "square", "helper", "main"}));
+
+  for (vcc::Statement *base : parser.getSyntaxTree())
+    base->codegen(parser.getHolder());
+  EXPECT_FALSE(parser.haveError());
+  EXPECT_EQ(parser.getHolder()->module.getFunction("unused"), nullptr);
+}
+
+TEST(CompTest, TestUndefinedEntryPoint) {
+  vcc::Parser parser = vcc::parseBuffer(
+      "function main gives int [int x,]{\n"
+      "    ret x;\n"
+      "}\n",
+      "<buffer>", vcc::lex::Tokenizer::Streaming, 20, 1,
+      {vcc::Symbol::intern("missing")});
+  EXPECT_EQ(parser.getHolder()->diagnostics.getErrorCount(), 1);
+  EXPECT_TRUE(parser.getSyntaxTree().empty());
+}
+
+/// the IR of a compilation, as vcc -print-llvm shows it
+static std::string printModule(const vcc::CompilerInstance &compiler) {
+  std::string ir;
+  llvm::raw_string_ostream os(ir);
+  compiler.getContext()->module.print(os, nullptr);
+  return os.str();
+}
+
+TEST(CompTest, TestCompileTwice) {
+  // nothing is left behind by the first compilation
+  vcc::CompilerInstance first;
+  ASSERT_TRUE(first.compileFile("resource/comp.vcc"));
+  vcc::CompilerInstance second;
+  ASSERT_TRUE(second.compileFile("resource/comp.vcc"));
+  EXPECT_FALSE(second.getSyntaxTree().empty());
+  EXPECT_EQ(printModule(first), printModule(second));
+}
+
+TEST(CompTest, TestConcurrentCompilations) {
+  vcc::CompilerInstance reference;
+  ASSERT_TRUE(reference.compileFile("resource/comp.vcc"));
+  std::string expected = printModule(reference);
+
+  std::vector<std::string> results(4);
+  std::vector<std::thread> threads;
+  for (std::string &result : results)
+    threads.emplace_back([&result] {
+      vcc::CompilerOptions options;
+      options.mode = vcc::lex::Tokenizer::PreTokenized;
+      vcc::CompilerInstance compiler(options);
+      if (compiler.compileFile("resource/comp.vcc"))
+        result = printModule(compiler);
+    });
+  for (std::thread &thread : threads)
+    thread.join();
+
+  for (const std::string &result : results)
+    EXPECT_EQ(result, expected);
+}
+
+TEST(CompTest, TestBufferedDiagnostics) {
+  vcc::CompilerOptions options;
+  options.buffer_diagnostics = true;
+  vcc::CompilerInstance compiler(options);
+  testing::internal::CaptureStderr();
+  EXPECT_FALSE(compiler.compileBuffer(broken_source));
+  EXPECT_EQ(testing::internal::GetCapturedStderr(), "");
+
+  const std::vector<std::string> &messages = compiler.getDiagnostics();
+  ASSERT_EQ(messages.size(), 4);
+  EXPECT_NE(messages.front().find("<buffer>:2:"), std::string::npos);
+}
+
+TEST(CompTest, TestBufferedErrorLimit) {
+  vcc::CompilerOptions options;
+  options.buffer_diagnostics = true;
+  options.error_limit = 2;
+  vcc::CompilerInstance compiler(options);
+  testing::internal::CaptureStderr();
+  EXPECT_FALSE(compiler.compileBuffer(broken_source));
+  EXPECT_EQ(testing::internal::GetCapturedStderr(), "");
+
+  const std::vector<std::string> &messages = compiler.getDiagnostics();
+  ASSERT_EQ(messages.size(), 3);
+  EXPECT_EQ(messages.back(), "too many errors emitted, stopping now\n");
+}
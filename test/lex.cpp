@@ -1,7 +1,11 @@
 #include "core/lex.h"
+#include "core/scan.h"
 #include <cstdio>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Demonstrate some basic assertions.
 TEST(LexTest, TokenTest) {
@@ -76,3 +80,343 @@ TEST(LexTest, NewToken) {
 
   std::remove("testing2.txt");
 }
+
+TEST(LexTest, LookaheadDoesNotChangeTokens) {
+  std::ofstream stream("testing3.txt");
+  stream << "function foo gives int [int a,]{\n"
+            "    ret foo(a - 1,) + deref<b>.c[2]; # comment\n"
+            "}\n";
+  stream.close();
+
+  std::vector<vcc::lex::TokenType> expected;
+  {
+    vcc::FileStream plain_stream("testing3.txt");
+    vcc::lex::Tokenizer plain(plain_stream);
+    while (plain.getCurrentType() != vcc::lex::EndOfFile) {
+      expected.push_back(plain.getCurrentType());
+      plain.consume();
+    }
+  }
+
+  vcc::FileStream some_stream("testing3.txt");
+  vcc::lex::Tokenizer tokenizer(some_stream);
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    for (int n = 1; n <= vcc::lex::Tokenizer::LookaheadSize; ++n) {
+      if (i + n < expected.size()) {
+        EXPECT_EQ(tokenizer.next(n).getType(), expected[i + n]);
+      }
+    }
+
+    EXPECT_EQ(tokenizer.getCurrentType(), expected[i]);
+    tokenizer.consume();
+  }
+  EXPECT_EQ(tokenizer.getCurrentType(), vcc::lex::EndOfFile);
+
+  std::remove("testing3.txt");
+}
+
+TEST(LexTest, PreTokenizedMatchesStreaming) {
+  vcc::FileStream streaming_stream("resource/comp.vcc");
+  vcc::lex::Tokenizer streaming(streaming_stream);
+
+  vcc::FileStream stream("resource/comp.vcc");
+  vcc::lex::Tokenizer tokenizer(stream, vcc::lex::Tokenizer::PreTokenized);
+
+  while (streaming.getCurrentType() != vcc::lex::EndOfFile) {
+    EXPECT_EQ(tokenizer.getCurrentType(), streaming.getCurrentType());
+    EXPECT_EQ(tokenizer.peekType(), streaming.peekType());
+    EXPECT_EQ(tokenizer.getPos(), streaming.getPos());
+    if (streaming.getCurrentType() == vcc::lex::Identifier) {
+      EXPECT_EQ(tokenizer.current().getStringLiteral(),
+                streaming.current().getStringLiteral());
+    }
+
+    streaming.consume();
+    tokenizer.consume();
+  }
+  EXPECT_EQ(tokenizer.getCurrentType(), vcc::lex::EndOfFile);
+
+  // going back is free
+  tokenizer.setIndex(0);
+  EXPECT_EQ(tokenizer.getCurrentType(), vcc::lex::FunctionDecl);
+  EXPECT_EQ(tokenizer.getNextType(), vcc::lex::Identifier);
+  EXPECT_EQ(tokenizer.current().getStringLiteral(), "add_two");
+}
+
+TEST(LexTest, KeywordTable) {
+  for (const vcc::lex::KeywordInfo &keyword : vcc::lex::keywords) {
+    EXPECT_EQ(vcc::lex::lookupKeyword(keyword.spelling), keyword.type);
+    EXPECT_EQ(vcc::lex::getPrecedence(keyword.type), keyword.precedence);
+  }
+
+  EXPECT_EQ(vcc::lex::lookupKeyword("functions"), vcc::lex::Invalid);
+  EXPECT_EQ(vcc::lex::lookupKeyword("add_two"), vcc::lex::Invalid);
+  EXPECT_EQ(vcc::lex::lookupKeyword(""), vcc::lex::Invalid);
+  EXPECT_TRUE(vcc::lex::isOneCharacterToken('+'));
+  EXPECT_FALSE(vcc::lex::isOneCharacterToken('a'));
+  EXPECT_GT(vcc::lex::getPrecedence(vcc::lex::Multiply),
+            vcc::lex::getPrecedence(vcc::lex::Add));
+}
+
+TEST(LexTest, ScanKernelsAgree) {
+  // long enough that every kernel runs its wide loop and its tail
+  std::string input = "function some_long_identifier_name_here gives int "
+                      "[int a,]{ # a comment that goes on for a while\n"
+                      "    ret 1234567+deref<b>.c[2];\n\n\n      \n}";
+  input += std::string(70, ' ') + "tail\n";
+  input += std::string(1, '\0') + "x";
+
+  vcc::scan::Kernel best = vcc::scan::getBestKernel();
+  for (vcc::scan::Kernel kernel :
+       {vcc::scan::Scalar, vcc::scan::SSE2, vcc::scan::AVX2}) {
+    if (kernel > best) {
+      EXPECT_FALSE(vcc::scan::setKernel(kernel));
+      continue;
+    }
+    ASSERT_TRUE(vcc::scan::setKernel(kernel));
+
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+    for (const char *at = begin; at != end; ++at) {
+      const char *white_space = at, *new_line = at, *token_end = at;
+      while (white_space != end &&
+             (*white_space == ' ' || *white_space == '\n'))
+        ++white_space;
+      while (new_line != end && *new_line != '\n')
+        ++new_line;
+      while (token_end != end && *token_end != ' ' && *token_end != '\n' &&
+             *token_end != '\0' && !vcc::lex::isOneCharacterToken(*token_end))
+        ++token_end;
+
+      EXPECT_EQ(vcc::scan::skipWhiteSpace(at, end), white_space);
+      EXPECT_EQ(vcc::scan::findNewLine(at, end), new_line);
+      EXPECT_EQ(vcc::scan::findTokenEnd(at, end), token_end);
+    }
+  }
+  vcc::scan::setKernel(best);
+}
+
+TEST(LexTest, BufferedMatchesStdio) {
+  std::ofstream stream("testing4.txt");
+  stream << "# comment at the start\n"
+            "function foo gives int [int a,]{\n"
+            "    ret foo(a - 1,)+\"some string\"; # comment\n"
+            "    int b = 123456789012;   #\n"
+            "}";
+  stream.close();
+
+  vcc::FileStream stdio_stream("testing4.txt", vcc::FileStream::Stdio);
+  vcc::lex::Tokenizer stdio(stdio_stream);
+
+  vcc::FileStream stream2("testing4.txt");
+  vcc::lex::Tokenizer tokenizer(stream2);
+
+  while (stdio.getCurrentType() != vcc::lex::EndOfFile) {
+    const vcc::lex::Token &expected = stdio.current();
+    const vcc::lex::Token &token = tokenizer.current();
+    EXPECT_EQ(token.getType(), expected.getType());
+    EXPECT_EQ(token.getOffset(), expected.getOffset());
+    EXPECT_EQ(tokenizer.getPos(), stdio.getPos());
+    if (expected.getType() == vcc::lex::Identifier ||
+        expected.getType() == vcc::lex::String) {
+      EXPECT_EQ(token.getStringLiteral(), expected.getStringLiteral());
+    }
+    if (expected.getType() == vcc::lex::IntegerLiteral) {
+      EXPECT_EQ(token.getIntegerLiteral(), expected.getIntegerLiteral());
+    }
+
+    stdio.consume();
+    tokenizer.consume();
+  }
+  EXPECT_EQ(tokenizer.getCurrentType(), vcc::lex::EndOfFile);
+
+  std::remove("testing4.txt");
+}
+
+TEST(LexTest, IdentifiersAreInterned) {
+  vcc::Symbol foo = vcc::Symbol::intern("foo");
+  EXPECT_EQ(foo, vcc::Symbol::intern(std::string("fo") + "o"));
+  EXPECT_NE(foo, vcc::Symbol::intern("bar"));
+  EXPECT_EQ(foo.str(), "foo");
+  EXPECT_TRUE(vcc::Symbol().empty());
+  EXPECT_EQ(vcc::Symbol::intern(""), vcc::Symbol());
+
+  std::ofstream stream("testing5.txt");
+  stream << "foo bar foo";
+  stream.close();
+
+  vcc::FileStream some_stream("testing5.txt");
+  vcc::lex::Tokenizer tokenizer(some_stream);
+  EXPECT_EQ(tokenizer.current().getSymbol(), foo);
+  EXPECT_EQ(tokenizer.next().getSymbol(), vcc::Symbol::intern("bar"));
+  EXPECT_EQ(tokenizer.next().getSymbol(), foo);
+
+  std::remove("testing5.txt");
+}
+
+TEST(LexTest, InternFromManyThreads) {
+  vcc::Symbol first = vcc::Symbol::intern("s0");
+  const std::string *first_spelling = &first.str();
+
+  // more spellings than fit in the first chunk of the table, read without a
+  // lock while the other threads keep adding
+  constexpr int Count = 5000;
+  std::vector<std::vector<vcc::Symbol>> interned(4);
+  std::vector<std::thread> threads;
+  for (std::vector<vcc::Symbol> &symbols : interned)
+    threads.emplace_back([&symbols] {
+      for (int i = 0; i < Count; ++i) {
+        std::string spelling = "s" + std::to_string(i);
+        symbols.push_back(vcc::Symbol::intern(spelling));
+        EXPECT_EQ(symbols.back().str(), spelling);
+      }
+    });
+  for (std::thread &thread : threads)
+    thread.join();
+
+  for (const std::vector<vcc::Symbol> &symbols : interned)
+    EXPECT_EQ(symbols, interned[0]);
+  // the spellings never move
+  EXPECT_EQ(&first.str(), first_spelling);
+}
+
+TEST(LexTest, ClearTables) {
+  vcc::Symbol::intern("foo");
+  vcc::lex::Token(123456789012LL, 0);
+
+  vcc::Symbol::clearTable();
+  vcc::lex::Token::clearLiteralTable();
+  EXPECT_EQ(vcc::Symbol::intern(""), vcc::Symbol());
+  EXPECT_EQ(vcc::Symbol::intern("bar").getID(), 1u);
+  EXPECT_EQ(vcc::Symbol::intern("bar").str(), "bar");
+
+  vcc::lex::Token large(-5, 0);
+  EXPECT_EQ(large.getPayload(), vcc::lex::Token::LargeLiteralBit);
+  EXPECT_EQ(large.getIntegerLiteral(), -5);
+}
+
+static void expectSameTokens(const vcc::lex::TokenStream &lhs,
+                             const vcc::lex::TokenStream &rhs) {
+  ASSERT_EQ(lhs.size(), rhs.size());
+  for (int i = 0; i < lhs.size(); ++i) {
+    ASSERT_EQ(lhs.getType(i), rhs.getType(i));
+    EXPECT_EQ(lhs.getOffset(i), rhs.getOffset(i));
+    if (lhs.getType(i) == vcc::lex::Identifier ||
+        lhs.getType(i) == vcc::lex::String) {
+      EXPECT_EQ(lhs.getStringLiteral(i), rhs.getStringLiteral(i));
+    }
+    if (lhs.getType(i) == vcc::lex::IntegerLiteral) {
+      EXPECT_EQ(lhs.getIntegerLiteral(i), rhs.getIntegerLiteral(i));
+    }
+  }
+}
+
+TEST(LexTest, ParallelTokenizeMatchesSequential) {
+  std::string source;
+  for (int i = 0; i < 200; ++i) {
+    std::string index = std::to_string(i);
+    source += "# function at column 3 of a comment\n";
+    source += "struct s" + index + " {\n    int a,\n}\n";
+    source += "function f" + index + " gives int [int a,]{\n";
+    source += "    ret a * " + index + " + \"text " + index + "\";\n}\n";
+  }
+  std::ofstream("testing6.txt") << source;
+
+  vcc::FileStream stream("testing6.txt");
+  auto sequential = vcc::lex::Tokenizer::tokenize(stream, 1);
+  for (unsigned thread_count : {2u, 7u, 64u}) {
+    auto parallel = vcc::lex::Tokenizer::tokenize(stream, thread_count);
+    expectSameTokens(*sequential, *parallel);
+  }
+
+  // a string that spans lines can hide a declaration at column 1, the split
+  // inside of it must be undone
+  std::ofstream("testing6.txt")
+      << source << "ptr char s = \"\nfunction in a string\n" << source
+      << "\";\n";
+  vcc::FileStream string_stream("testing6.txt");
+  sequential = vcc::lex::Tokenizer::tokenize(string_stream, 1);
+  for (unsigned thread_count : {2u, 3u, 16u}) {
+    auto parallel = vcc::lex::Tokenizer::tokenize(string_stream, thread_count);
+    expectSameTokens(*sequential, *parallel);
+  }
+
+  std::remove("testing6.txt");
+}
+
+TEST(LexTest, RelexMatchesFullLex) {
+  std::string source;
+  for (int i = 0; i < 100; ++i) {
+    std::string index = std::to_string(i);
+    source += "function f" + index + " gives int [int a,]{ # comment\n";
+    source += "    ret a * " + index + " + \"text\";\n}\n";
+  }
+
+  struct Edit {
+    long offset, removed_length;
+    std::string inserted;
+  };
+  long middle = source.find("function f50");
+  std::vector<Edit> edits = {
+      {middle + 10, 0, "x"},              // inside an identifier
+      {middle + 10, 2, ""},               // removing the end of it
+      {middle, 0, "\""},                  // opening a string
+      {middle, 0, "#"},                   // commenting a line out
+      {middle + 8, 1, "("},               // splitting two words
+      {middle - 3, 10, " 12 + 3 "},       // across lines and tokens
+      {0, 0, "  "},                       // before the first token
+      {(long)source.size(), 0, " end"},   // after the last one
+      {0, (long)source.size(), "ret 1;"}, // everything
+  };
+
+  std::ofstream("testing7.txt") << source;
+  vcc::FileStream stream("testing7.txt");
+  std::shared_ptr<vcc::lex::TokenStream> original =
+      vcc::lex::Tokenizer::tokenize(stream);
+
+  for (const Edit &edit : edits) {
+    std::string edited = source;
+    edited.replace(edit.offset, edit.removed_length, edit.inserted);
+    std::ofstream("testing8.txt") << edited;
+    vcc::FileStream edited_stream("testing8.txt");
+
+    vcc::lex::TokenStream tokens = *original;
+    vcc::lex::TextEdit text_edit{edit.offset, edit.removed_length,
+                                 std::string_view(edited).substr(
+                                     edit.offset, edit.inserted.size())};
+    int relexed = vcc::lex::Tokenizer::relex(tokens, edited, text_edit);
+    expectSameTokens(tokens, *vcc::lex::Tokenizer::tokenize(edited_stream));
+
+    // an edit inside one identifier only lexes around it
+    if (&edit == &edits[0]) {
+      EXPECT_LE(relexed, 2);
+    }
+  }
+
+  std::remove("testing7.txt");
+  std::remove("testing8.txt");
+}
+
+TEST(LexTest, TokenPayloads) {
+  vcc::lex::Token small(42LL, 7);
+  EXPECT_EQ(small.getType(), vcc::lex::IntegerLiteral);
+  EXPECT_EQ(small.getIntegerLiteral(), 42);
+  EXPECT_EQ(small.getOffset(), 7);
+
+  // too large for the payload, kept in the literal table
+  vcc::lex::Token large(123456789012LL, 8);
+  EXPECT_EQ(large.getIntegerLiteral(), 123456789012LL);
+  EXPECT_EQ(vcc::lex::Token(123456789012LL, 9).getPayload(), large.getPayload());
+
+  // strings are interned like identifiers
+  vcc::lex::Token string(vcc::lex::String, vcc::Symbol::intern("some text"), 3);
+  EXPECT_EQ(string.getStringLiteral(), "some text");
+  EXPECT_EQ(string.getSymbol(), vcc::Symbol::intern("some text"));
+
+  vcc::lex::TokenStream tokens;
+  tokens.push(large);
+  tokens.push(string);
+  EXPECT_EQ(tokens.getIntegerLiteral(0), 123456789012LL);
+  EXPECT_EQ(tokens.getStringLiteral(1), "some text");
+  EXPECT_EQ(tokens.getOffset(1), 3);
+}
@@ -0,0 +1,48 @@
+#include "core/driver.h"
+#include "core/parser.h"
+#include "core/source.h"
+
+#include <gtest/gtest.h>
+
+using vcc::FilePos;
+using vcc::SourceLocation;
+using vcc::SourceManager;
+
+TEST(SourceTest, LocationsAcrossFiles) {
+  SourceManager sources;
+  SourceManager::FileID prelude =
+      sources.addBuffer("int a;\nint b;", "prelude");
+  SourceManager::FileID main = sources.addFile("resource/streamtest.txt");
+  EXPECT_EQ(sources.getFileCount(), 2);
+
+  SourceLocation b = sources.getLocation(prelude, 11);
+  EXPECT_TRUE(b.isValid());
+  EXPECT_EQ(sources.getFileID(b), prelude);
+  EXPECT_EQ(sources.getFileOffset(b), 11);
+  EXPECT_EQ(sources.getPos(b), (FilePos{2, 5, 11}));
+  EXPECT_EQ(sources.getLine(b), "int b;");
+  EXPECT_EQ(sources.getName(b), "prelude");
+
+  // the end of the prelude and the start of the next file are different
+  SourceLocation prelude_end = sources.getLocation(prelude, 13);
+  SourceLocation main_begin = sources.getLocation(main, 0);
+  EXPECT_LT(prelude_end, main_begin);
+  EXPECT_EQ(sources.getFileID(prelude_end), prelude);
+  EXPECT_EQ(sources.getFileID(main_begin), main);
+  EXPECT_EQ(sources.getLine(main_begin), "This");
+  EXPECT_EQ(sources.getPos(main_begin.getLocWithOffset(6)), (FilePos{2, 2, 6}));
+  EXPECT_EQ(sources.getName(main_begin), "resource/streamtest.txt");
+
+  EXPECT_FALSE(SourceLocation().isValid());
+}
+
+TEST(SourceTest, NodesHaveLocations) {
+  vcc::Parser parser =
+      vcc::parseBuffer("\n\nfunction foo gives int [] {\n    ret 1;\n}", "foo");
+  ASSERT_EQ(parser.getSyntaxTree().size(), 1);
+
+  vcc::SourceManager &sources = parser.getHolder()->sources;
+  SourceLocation loc = parser.getSyntaxTree()[0]->getLocation();
+  EXPECT_EQ(sources.getName(loc), "foo");
+  EXPECT_EQ(sources.getPos(loc).row, 3);
+}
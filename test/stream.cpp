@@ -2,8 +2,14 @@
 #include <cstdio>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <string>
+#include <thread>
 #include <type_traits>
 
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
 using vcc::FilePos;
 
 // Demonstrate some basic assertions.
@@ -51,3 +57,128 @@ TEST(StreamTest, SeekTest) {
   EXPECT_EQ(stream.getLine(0), "This");
   EXPECT_EQ(stream.tellg(), 5);
 }
+
+TEST(StreamTest, StdioSeeksAhead) {
+  vcc::FileStream stdio("resource/streamtest.txt", vcc::FileStream::Stdio);
+
+  // nothing was read yet, seekg and getLine extend the line table
+  EXPECT_EQ(stdio.getPos(9), (FilePos{3, 2, 9}));
+  EXPECT_EQ(stdio.tellg(), 0);
+  stdio.seekg(7);
+  EXPECT_EQ(stdio.getPos(), (FilePos{2, 3, 7}));
+  EXPECT_EQ(stdio.get(), '\n');
+  EXPECT_EQ(stdio.getPos(), (FilePos{3, 1, 8}));
+  EXPECT_EQ(stdio.getLine(12), "some");
+  EXPECT_EQ(stdio.getLine(0), "This");
+  EXPECT_EQ(stdio.tellg(), 8);
+}
+
+TEST(StreamTest, BackendsAgree) {
+  vcc::FileStream buffered("resource/streamtest.txt",
+                           vcc::FileStream::Buffered);
+  vcc::FileStream stdio("resource/streamtest.txt", vcc::FileStream::Stdio);
+
+  while (!buffered.eof() || !stdio.eof()) {
+    EXPECT_EQ(buffered.peek(), stdio.peek());
+    EXPECT_EQ(buffered.get(), stdio.get());
+    EXPECT_EQ(buffered.tellg(), stdio.tellg());
+    EXPECT_EQ(buffered.getPos(), stdio.getPos());
+    EXPECT_EQ(buffered.eof(), stdio.eof());
+  }
+
+  EXPECT_EQ(buffered.getLine(6), stdio.getLine(6));
+  EXPECT_EQ(buffered.getLine(12), "some");
+
+  buffered.seekg(7);
+  EXPECT_EQ(buffered.getPos(), (FilePos{2, 3, 7}));
+  EXPECT_EQ(buffered.get(), '\n');
+  EXPECT_EQ(buffered.getPos(), (FilePos{3, 1, 8}));
+}
+
+#ifndef _WIN32
+TEST(StreamTest, StreamedFromPipe) {
+  // a few chunks long, so that the window has to move
+  std::string content;
+  for (int i = 0; i < 20000; ++i)
+    content += "line " + std::to_string(i) + "\n";
+  content += "last";
+  std::ofstream("streamtest_big.txt", std::ios::binary) << content;
+
+  ASSERT_EQ(mkfifo("streamtest.fifo", 0600), 0);
+  std::thread writer([&content] {
+    std::ofstream("streamtest.fifo", std::ios::binary) << content;
+  });
+
+  vcc::FileStream buffered("streamtest_big.txt");
+  vcc::FileStream streamed("streamtest.fifo", vcc::FileStream::Buffered);
+  EXPECT_EQ(streamed.getBackend(), vcc::FileStream::Streamed);
+
+  while (!buffered.eof() || !streamed.eof()) {
+    EXPECT_EQ(buffered.peek(), streamed.peek());
+    EXPECT_EQ(buffered.get(), streamed.get());
+    EXPECT_EQ(buffered.tellg(), streamed.tellg());
+    EXPECT_EQ(buffered.getPos(), streamed.getPos());
+    EXPECT_EQ(buffered.eof(), streamed.eof());
+
+    // backtracking inside the window
+    if (streamed.tellg() % 1000 == 999) {
+      streamed.seekg(streamed.tellg() - 100);
+      streamed.seekg(streamed.tellg() + 100);
+    }
+  }
+  writer.join();
+
+  long end = content.size();
+  EXPECT_EQ(streamed.getLine(end - 1), "last");
+  EXPECT_EQ(streamed.getLine(end - 6), "line 19999");
+  EXPECT_EQ(streamed.getPos(end), buffered.getPos(end));
+
+  std::remove("streamtest.fifo");
+  std::remove("streamtest_big.txt");
+}
+
+TEST(StreamTest, StreamedLineLeftWindow) {
+  std::string content = "first line\n";
+  while (content.size() < 4 * vcc::FileStream::BacktrackWindow)
+    content += "filler\n";
+  content += "last";
+
+  ASSERT_EQ(mkfifo("streamtest_window.fifo", 0600), 0);
+  std::thread writer([&content] {
+    std::ofstream("streamtest_window.fifo", std::ios::binary) << content;
+  });
+
+  vcc::FileStream streamed("streamtest_window.fifo");
+  while (!streamed.eof())
+    streamed.get();
+  writer.join();
+
+  // the first line is far behind the window, but its position is still known
+  EXPECT_EQ(streamed.getLine(3), "");
+  EXPECT_EQ(streamed.getPos(3), (FilePos{1, 4, 3}));
+  EXPECT_EQ(streamed.getLine(content.size() - 1), "last");
+
+  std::remove("streamtest_window.fifo");
+}
+#endif
+
+TEST(StreamTest, InMemory) {
+  vcc::FileStream stream(std::string_view("This\nis"), "<memory>");
+  EXPECT_TRUE(stream.is_open());
+  EXPECT_EQ(stream.getName(), "<memory>");
+  EXPECT_EQ(stream.getBackend(), vcc::FileStream::Buffered);
+
+  stream.seekg(4);
+  EXPECT_EQ(stream.get(), '\n');
+  EXPECT_EQ(stream.getPos(), (FilePos{2, 1, 5}));
+  EXPECT_EQ(stream.getLine(6), "is");
+  EXPECT_EQ(stream.getLine(0), "This");
+}
+
+TEST(StreamTest, MissingFile) {
+  // an error is left to the caller, the stream reads as an empty file
+  vcc::FileStream stream("resource/does-not-exist.txt");
+  EXPECT_FALSE(stream.is_open());
+  EXPECT_EQ(stream.peek(), 0);
+  EXPECT_TRUE(stream.eof());
+}
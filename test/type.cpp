@@ -1,7 +1,9 @@
+#include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Type.h"
 #include "core/context.h"
 #include "core/type.h"
 #include <gtest/gtest.h>
+#include <sstream>
 
 TEST(Type, BasicTest) {
   vcc::ContextHolder holder =
@@ -17,17 +19,21 @@ TEST(Type, BasicTest) {
   // struct Outer{
   //     int a, int b, int c,
   // }
-  vcc::StructType outer({{0, "a", &a}, {1, "b", &b}, {2, "c", &c}}, "asfdas");
+  vcc::Symbol a_name = vcc::Symbol::intern("a");
+  vcc::Symbol b_name = vcc::Symbol::intern("b");
+  vcc::Symbol c_name = vcc::Symbol::intern("c");
+  vcc::StructType outer({{0, a_name, &a}, {1, b_name, &b}, {2, c_name, &c}},
+                        vcc::Symbol::intern("asfdas"));
   llvm::Type *interger = llvm::Type::getInt32Ty(holder->context);
   // the struct name for codegen has a struct prefix
   EXPECT_EQ(outer.getType(holder)->getStructName(), "struct.asfdas");
-  EXPECT_EQ(outer.getElement("c").value().name, "c");
-  EXPECT_EQ(outer.getElement("c").value().field_num, 2);
-  EXPECT_EQ(outer.getElement("c").value().type->getType(holder),
+  EXPECT_EQ(outer.getElement(c_name).name, c_name);
+  EXPECT_EQ(outer.getElement(c_name).field_num, 2);
+  EXPECT_EQ(outer.getElement(c_name).type->getType(holder),
             llvm::Type::getInt32Ty(holder->context));
 
   // Pointer test
-  EXPECT_FALSE(outer.getElement("c").value().type->isPointer());
+  EXPECT_FALSE(outer.getElement(c_name).type->isPointer());
 
   vcc::PointerType pointer_to_a(&a);
   EXPECT_TRUE(pointer_to_a.isPointer());
@@ -76,3 +82,70 @@ TEST(Type, BasicTest) {
   EXPECT_FALSE(bool_type.isInt());
   EXPECT_EQ(bool_type.getType(holder), llvm::Type::getInt1Ty(holder->context));
 }
+
+TEST(Type, UniqueTypes) {
+  vcc::ContextHolder holder =
+      std::make_shared<vcc::GlobalContext>("resource/comp.vcc");
+  vcc::TypeContext &types = *holder->types;
+
+  vcc::BuiltinType *integer = types.getBuiltinType(vcc::BuiltinType::Int);
+  EXPECT_EQ(integer, types.getBuiltinType(vcc::BuiltinType::Int));
+  EXPECT_NE(static_cast<vcc::Type *>(integer),
+            types.getBuiltinType(vcc::BuiltinType::Long));
+  EXPECT_EQ(types.getVoidType(), types.getVoidType());
+
+  // ptr ptr int, built twice
+  vcc::PointerType *pointer =
+      types.getPointerType(types.getPointerType(integer));
+  EXPECT_EQ(pointer, types.getPointerType(types.getPointerType(integer)));
+  EXPECT_TRUE(vcc::Type::isSame(pointer->getPointee(),
+                                types.getPointerType(integer)));
+
+  // array (10) int is not array (20) int
+  vcc::ArrayType *array = types.getArrayType(integer, 10);
+  EXPECT_EQ(array, types.getArrayType(integer, 10));
+  EXPECT_FALSE(vcc::Type::isSame(array, types.getArrayType(integer, 20)));
+
+  // the llvm::Type is created once and then cached
+  llvm::Type *llvm_array = array->getType(holder);
+  EXPECT_EQ(llvm_array, llvm::ArrayType::get(integer->getType(holder), 10));
+  EXPECT_EQ(array->getType(holder), llvm_array);
+}
+
+TEST(Type, StructLayout) {
+  vcc::ContextHolder holder =
+      std::make_shared<vcc::GlobalContext>("resource/comp.vcc");
+  vcc::TypeContext &types = *holder->types;
+  vcc::Type *character = types.getBuiltinType(vcc::BuiltinType::Char);
+  vcc::Type *integer = types.getBuiltinType(vcc::BuiltinType::Int);
+
+  // struct Padded{ char a, int b, char c, }
+  vcc::Symbol a = vcc::Symbol::intern("a");
+  vcc::Symbol b = vcc::Symbol::intern("b");
+  vcc::Symbol c = vcc::Symbol::intern("c");
+  vcc::StructType *padded = types.createStructType(
+      {{0, a, character}, {1, b, integer}, {2, c, character}},
+      vcc::Symbol::intern("Padded"));
+  EXPECT_TRUE(padded->hasElement(b));
+  EXPECT_FALSE(padded->hasElement(vcc::Symbol::intern("d")));
+  EXPECT_EQ(&padded->getElement(c), &padded->getElements()[2]);
+
+  EXPECT_EQ(padded->getElementOffset(holder, 0), 0);
+  EXPECT_EQ(padded->getElementOffset(holder, 1), 4);
+  EXPECT_EQ(padded->getElementOffset(holder, 2), 8);
+  EXPECT_EQ(padded->getElementSize(holder, 1), 4);
+  EXPECT_EQ(padded->getElementSize(holder, 2), 1);
+  EXPECT_EQ(padded->getSize(holder), 12);
+}
+
+TEST(Type, ArenaStats) {
+  vcc::TypeContext types;
+  std::ostringstream before;
+  types.printStats(before);
+  EXPECT_NE(before.str().find("bytes allocated"), std::string::npos);
+
+  types.getPointerType(types.getBuiltinType(vcc::BuiltinType::Int));
+  std::ostringstream after;
+  types.printStats(after);
+  EXPECT_NE(before.str(), after.str());
+}